@@ -0,0 +1,78 @@
+// Throughput of the batched RL environment (vector_env.h): steps a number of
+// instances of one ROM with random actions and reports env-steps/s as JSON.
+//
+//   EnvBench [--rom FILE] [--envs N] [--steps N] [--frame-skip N]
+//            [--threads N] [--bytes]
+//
+// An env-step is one instance advanced by --frame-skip frames, including its
+// observation, reward and done flag.
+
+#include "vector_env.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+
+int main(int argc, char* argv[]) {
+    std::string romPath = "../roms/BRIX";
+    size_t envs = 256;
+    uint32_t stepCount = 2000;
+    EnvConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rom" && hasValue) romPath = argv[++i];
+        else if (arg == "--envs" && hasValue) envs = std::stoul(argv[++i]);
+        else if (arg == "--steps" && hasValue) stepCount = std::stoul(argv[++i]);
+        else if (arg == "--frame-skip" && hasValue) config.frameSkip = std::stoul(argv[++i]);
+        else if (arg == "--threads" && hasValue) config.threads = std::stoul(argv[++i]);
+        else if (arg == "--bytes") config.observation = ObservationFormat::Bytes;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--rom FILE] [--envs N] [--steps N] [--frame-skip N]\n"
+                      << "       [--threads N] [--bytes]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ifstream file(romPath, std::ios::binary);
+    config.rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    VectorEnv env;
+    if (!env.Open(config, envs)) {
+        std::cerr << "Cannot load ROM " << romPath << std::endl;
+        return 2;
+    }
+
+    std::vector<uint8_t> observations(env.Count() * env.ObservationSize());
+    std::vector<uint16_t> actions(env.Count());
+    std::vector<float> rewards(env.Count());
+    std::vector<uint8_t> done(env.Count());
+    env.Reset(nullptr, observations.data());
+
+    // Random actions are drawn up front so that only the environment is timed
+    std::mt19937 rng(1);
+    std::vector<uint16_t> actionPool(4096);
+    for (uint16_t& keys : actionPool) keys = static_cast<uint16_t>(1 << (rng() % 16));
+
+    uint64_t episodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t step = 0; step < stepCount; ++step) {
+        for (size_t i = 0; i < actions.size(); ++i) actions[i] = actionPool[(step * 31 + i) % actionPool.size()];
+        env.Step(actions.data(), observations.data(), rewards.data(), done.data());
+        for (uint8_t d : done) episodes += d;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "{\"benchmark\": \"env\", \"rom\": \"" << romPath << "\", \"envs\": " << env.Count()
+              << ", \"steps\": " << stepCount << ", \"frame_skip\": " << config.frameSkip
+              << ", \"threads\": " << config.threads
+              << ", \"observation\": \"" << (config.observation == ObservationFormat::Bits ? "bits" : "bytes")
+              << "\", \"episodes\": " << episodes << ", \"env_steps_per_second\": " << std::fixed
+              << std::setprecision(0) << static_cast<double>(env.Count()) * stepCount / seconds << "}" << std::endl;
+    return 0;
+}
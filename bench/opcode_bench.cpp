@@ -0,0 +1,390 @@
+// Opcode microbenchmarks.
+//
+// Times every handler in opcodes.cpp in isolation (decoded through the same
+// dispatch tables Cycle() uses, but without fetch, trace or timer updates),
+// then the full Cycle() path, the Reset()/LoadROM() entry points and cloning.
+//
+// Results are written to stdout as a single JSON document so runs can be
+// diffed across commits and dispatch strategies:
+//
+//   OpcodeBench [--iterations N] [--repeat R] [--filter TEXT] [--perf] > results.json
+//
+// Each figure is the best of R repetitions, which is the most stable
+// estimate on a noisy machine. With --perf, host hardware counters are
+// collected over all repetitions (see perf_counters.h) and reported per
+// executed handler, which shows directly how much of the cost is branch
+// mispredicts in the member-function-pointer dispatch.
+
+#include "chip8.h"
+#include "machine_arena.h"
+#include "perf_counters.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+struct BenchResult {
+    std::string name;
+    uint16_t opcode;
+    uint64_t iterations;
+    double nsPerOp;
+    PerfSample perf;        // Summed over all repetitions
+    uint64_t perfOps;       // Operations covered by perf
+};
+
+
+class OpcodeBench {
+public:
+    OpcodeBench(uint64_t iterations, int repeat, std::string filter, PerfCounters* counters)
+        : iterations(iterations), repeat(repeat), filter(std::move(filter)), counters(counters) {}
+
+    void RunAll();
+    void WriteJSON(std::ostream& out) const;
+
+private:
+    uint64_t iterations;
+    int repeat;
+    std::string filter;
+    PerfCounters* counters;             // nullptr unless --perf
+    std::vector<BenchResult> results;
+
+    // Counters of the last Time() call
+    PerfSample lastPerf;
+    uint64_t lastPerfOps{};
+
+    bool Selected(const std::string& name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // Best-of-repeat nanoseconds per call of body(), which performs `batch` operations.
+    double Time(uint64_t batch, const std::function<void()>& body);
+
+    void Add(const std::string& name, uint16_t opcode, uint64_t batch, double ns) {
+        results.push_back({name, opcode, batch, ns, lastPerf, lastPerfOps});
+    }
+
+    // Put the machine into a state where `opcode` can be executed over and over
+    // without running off the end of memory, the stack or the display.
+    static void Prepare(Chip8& chip8, uint16_t opcode);
+
+    void BenchHandler(const std::string& name, uint16_t opcode);
+    void BenchHandlerPair(const std::string& name, uint16_t first, uint16_t second);
+    void BenchSuperChip(const std::string& name, uint16_t opcode, bool hires);
+    void BenchCycle();
+    void BenchResetAndLoad();
+
+    // Decode and execute the opcode exactly like Cycle() does, minus the fetch.
+    static void Execute(Chip8& chip8, uint16_t opcode) {
+        chip8.opcode = opcode;
+        (chip8.*chip8.table[static_cast<unsigned int>(chip8.quirks)][(opcode & 0xF000) >> 12])();
+    }
+};
+
+
+double OpcodeBench::Time(uint64_t batch, const std::function<void()>& body) {
+    double best = 0;
+    lastPerf = {};
+    lastPerfOps = 0;
+
+    for (int r = 0; r < repeat; ++r) {
+        if (counters) counters->Start();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+
+        if (counters) {
+            PerfSample sample = counters->Stop();
+            if (r == 0) lastPerf = sample;
+            else Accumulate(lastPerf, sample);
+            lastPerfOps += batch;
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(batch);
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+
+void OpcodeBench::Prepare(Chip8& chip8, uint16_t opcode) {
+    chip8.Reset();
+
+    // Give every register a distinct, non-zero value so that the ALU ops
+    // exercise both carry/borrow outcomes over the run.
+    for (int i = 0; i < REGISTER_COUNT; ++i) chip8.V[i] = static_cast<uint8_t>(0x11 * i + 7);
+
+    // Scratch area for Fx33/Fx55/Fx65 and sprite data for Dxyn (32 bytes for
+    // a 16x16 Dxy0).
+    chip8.I = 0x300;
+    for (int i = 0; i < 32; ++i) chip8.Poke(0x300 + i, static_cast<uint8_t>(0xA5 ^ (i * 0x3B)));
+
+    if ((opcode & 0xF000) == 0xD000) {
+        // Draw near the middle of the screen so every row and column is on-screen
+        chip8.V[0x0] = 20;
+        chip8.V[0x1] = 8;
+    }
+    if ((opcode & 0xF0FF) == 0xE09E || (opcode & 0xF0FF) == 0xE0A1 || (opcode & 0xF0FF) == 0xF00A) {
+        chip8.V[(opcode & 0x0F00) >> 8] = 0x5;
+        chip8.key[0x5] = 1;
+    }
+    if ((opcode & 0xF0FF) == 0xF029) {
+        chip8.V[(opcode & 0x0F00) >> 8] = 0xA;
+    }
+}
+
+
+void OpcodeBench::BenchHandler(const std::string& name, uint16_t opcode) {
+    if (!Selected(name)) return;
+
+    Chip8 chip8;
+    Prepare(chip8, opcode);
+
+    double ns = Time(iterations, [&] {
+        for (uint64_t i = 0; i < iterations; ++i) Execute(chip8, opcode);
+    });
+    Add(name, opcode, iterations, ns);
+}
+
+
+// Handlers that cannot repeat on their own (2nnn would overflow the stack,
+// 00EE would underflow it) are timed as a balanced pair.
+void OpcodeBench::BenchHandlerPair(const std::string& name, uint16_t first, uint16_t second) {
+    if (!Selected(name)) return;
+
+    Chip8 chip8;
+    Prepare(chip8, first);
+
+    double ns = Time(iterations, [&] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Execute(chip8, first);
+            Execute(chip8, second);
+        }
+    });
+    Add(name, first, iterations, ns);
+}
+
+
+// The SUPER-CHIP handlers, on a machine in the SuperChip profile and in
+// either display mode. Hires sprites are drawn across the boundary between
+// the two words of a row, the most work a packed row takes.
+void OpcodeBench::BenchSuperChip(const std::string& name, uint16_t opcode, bool hires) {
+    if (!Selected(name)) return;
+
+    Chip8 chip8;
+    chip8.SetQuirks(QuirkProfile::SuperChip);
+    Prepare(chip8, opcode);
+    if (hires) {
+        Execute(chip8, 0x00FF);
+        chip8.V[0x0] = 60;
+        chip8.V[0x1] = 24;
+    }
+
+    double ns = Time(iterations, [&] {
+        for (uint64_t i = 0; i < iterations; ++i) Execute(chip8, opcode);
+    });
+    Add(name, opcode, iterations, ns);
+}
+
+
+// Cycle() on a straight run of 6xkk with a jump back to the start, so the
+// difference to the bare 6xkk handler is the fetch/trace/timer overhead.
+void OpcodeBench::BenchCycle() {
+    if (!Selected("cycle")) return;
+
+    Chip8 chip8;
+    Prepare(chip8, 0x6000);
+
+    const unsigned int loopLength = 256;
+    for (unsigned int i = 0; i < loopLength - 1; ++i) {
+        chip8.Poke(START_INSTRUCTION_ADDRESS + 2 * i, 0x60 | (i & 0xF));
+        chip8.Poke(START_INSTRUCTION_ADDRESS + 2 * i + 1, static_cast<uint8_t>(i));
+    }
+    chip8.Poke(START_INSTRUCTION_ADDRESS + 2 * (loopLength - 1), 0x12);    // 1200: JP 0x200
+    chip8.Poke(START_INSTRUCTION_ADDRESS + 2 * (loopLength - 1) + 1, 0x00);
+
+    double cycleNs = Time(iterations, [&] {
+        for (uint64_t i = 0; i < iterations; ++i) chip8.Cycle();
+    });
+    Add("cycle", 0x6000, iterations, cycleNs);
+
+    // Bare handler for the same instruction mix
+    double handlerNs = Time(iterations, [&] {
+        for (uint64_t i = 0; i < iterations; ++i) Execute(chip8, 0x6000 | (i & 0x0FFF));
+    });
+    Add("cycle_overhead", 0x6000, iterations, cycleNs - handlerNs);
+}
+
+
+void OpcodeBench::BenchResetAndLoad() {
+    // Reset() and LoadROM() are orders of magnitude slower than a handler, so
+    // they get a smaller iteration count.
+    uint64_t count = iterations / 1000 > 0 ? iterations / 1000 : 1;
+
+    if (Selected("reset")) {
+        Chip8 chip8;
+        double ns = Time(count, [&] {
+            for (uint64_t i = 0; i < count; ++i) chip8.Reset();
+        });
+        Add("reset", 0, count, ns);
+    }
+
+    if (Selected("reset_dirty")) {
+        // Reset after an Fx55 has touched one page, as in a fuzzing loop
+        Chip8 chip8;
+        double ns = Time(count, [&] {
+            for (uint64_t i = 0; i < count; ++i) {
+                chip8.I = 0x300;
+                Execute(chip8, 0xFF55);
+                chip8.Reset();
+            }
+        });
+        Add("reset_dirty", 0xFF55, count, ns);
+    }
+
+    if (Selected("clone")) {
+        // Branch a running machine into 64 children and throw them away, as a
+        // tree search does; reported per child
+        Chip8 parent;
+        Prepare(parent, 0x6000);
+        MachineArena arena;
+        double ns = Time(count, [&] {
+            for (uint64_t i = 0; i < count; ++i) {
+                arena.Clone(parent);
+                if (arena.Live() == 64) arena.ReleaseAll();
+            }
+        });
+        Add("clone", 0, count, ns);
+    }
+
+    if (Selected("load_rom")) {
+        // A maximum-size ROM so the figure is an upper bound
+        std::filesystem::path romPath = std::filesystem::temp_directory_path() / "chip8_opcode_bench.ch8";
+        {
+            std::ofstream rom(romPath, std::ios::binary);
+            for (unsigned int i = 0; i < MAX_ROM_SIZE; ++i) rom.put(static_cast<char>(i));
+        }
+
+        Chip8 chip8;
+        double ns = Time(count, [&] {
+            for (uint64_t i = 0; i < count; ++i) chip8.LoadROM(romPath.string());
+        });
+        Add("load_rom", 0, count, ns);
+
+        std::filesystem::remove(romPath);
+    }
+}
+
+
+void OpcodeBench::RunAll() {
+    BenchHandler("00E0", 0x00E0);
+    BenchHandlerPair("2nnn+00EE", 0x2300, 0x00EE);
+    BenchHandler("1nnn", 0x1200);
+    BenchHandler("3xkk", 0x3312);
+    BenchHandler("4xkk", 0x4312);
+    BenchHandler("5xy0", 0x5120);
+    BenchHandler("6xkk", 0x6312);
+    BenchHandler("7xkk", 0x7312);
+    BenchHandler("8xy0", 0x8120);
+    BenchHandler("8xy1", 0x8121);
+    BenchHandler("8xy2", 0x8122);
+    BenchHandler("8xy3", 0x8123);
+    BenchHandler("8xy4", 0x8124);
+    BenchHandler("8xy5", 0x8125);
+    BenchHandler("8xy6", 0x8126);
+    BenchHandler("8xy7", 0x8127);
+    BenchHandler("8xyE", 0x812E);
+    BenchHandler("9xy0", 0x9120);
+    BenchHandler("Annn", 0xA300);
+    BenchHandler("Bnnn", 0xB300);
+    BenchHandler("Cxkk", 0xC3FF);
+    BenchHandler("Dxy1", 0xD011);
+    BenchHandler("Dxy5", 0xD015);
+    BenchHandler("Dxy8", 0xD018);
+    BenchHandler("DxyF", 0xD01F);
+    BenchHandler("Ex9E", 0xE39E);
+    BenchHandler("ExA1", 0xE3A1);
+    BenchHandler("Fx07", 0xF307);
+    BenchHandler("Fx0A", 0xF30A);
+    BenchHandler("Fx15", 0xF315);
+    BenchHandler("Fx18", 0xF318);
+    BenchHandler("Fx1E", 0xF31E);
+    BenchHandler("Fx29", 0xF329);
+    BenchHandler("Fx33", 0xF333);
+    BenchHandler("Fx55/1", 0xF055);
+    BenchHandler("Fx55/16", 0xFF55);
+    BenchHandler("Fx65/1", 0xF065);
+    BenchHandler("Fx65/16", 0xFF65);
+
+    BenchSuperChip("Dxy0/lores", 0xD010, false);
+    BenchSuperChip("Dxy0/hires", 0xD010, true);
+    BenchSuperChip("Dxy8/hires", 0xD018, true);
+    BenchSuperChip("00E0/hires", 0x00E0, true);
+    BenchSuperChip("00Cn/lores", 0x00C1, false);
+    BenchSuperChip("00Cn/hires", 0x00C1, true);
+    BenchSuperChip("00FB/lores", 0x00FB, false);
+    BenchSuperChip("00FB/hires", 0x00FB, true);
+    BenchSuperChip("00FC/lores", 0x00FC, false);
+    BenchSuperChip("00FC/hires", 0x00FC, true);
+
+    BenchCycle();
+    BenchResetAndLoad();
+}
+
+
+void OpcodeBench::WriteJSON(std::ostream& out) const {
+    char line[160];
+
+    out << "{\"benchmark\":\"opcode\",\"repeat\":" << repeat << ",\"results\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"opcode\":\"%04X\",\"iterations\":%llu,\"ns_per_op\":%.3f",
+                 r.name.c_str(), r.opcode, static_cast<unsigned long long>(r.iterations), r.nsPerOp);
+        out << line;
+        if (counters) {
+            out << ",\"perf\":";
+            WritePerfJSON(out, r.perf, r.perfOps);
+        }
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+}
+
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 1000000;
+    int repeat = 5;
+    std::string filter;
+    bool perf = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) iterations = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::stoi(argv[++i]);
+        else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--perf") perf = true;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--repeat R] [--filter TEXT] [--perf]" << std::endl;
+            return 1;
+        }
+    }
+    if (iterations == 0 || repeat <= 0) {
+        std::cerr << "--iterations and --repeat must be positive" << std::endl;
+        return 1;
+    }
+
+    PerfCounters counters;
+    if (perf && !counters.Available()) {
+        std::cerr << "Hardware counters unavailable (check /proc/sys/kernel/perf_event_paranoid); "
+                     "reporting timings only" << std::endl;
+    }
+
+    OpcodeBench bench(iterations, repeat, filter, perf && counters.Available() ? &counters : nullptr);
+    bench.RunAll();
+    bench.WriteJSON(std::cout);
+
+    return 0;
+}
@@ -0,0 +1,353 @@
+// Whole-ROM macro benchmark and performance regression gate.
+//
+// Runs every ROM in a directory headless for a fixed number of frames with a
+// scripted input sequence and a fixed RNG seed, and reports instructions/s,
+// frames/s and a framebuffer hash per ROM as JSON:
+//
+//   RomBench [--roms DIR] [--frames N] [--cycles-per-frame N] [--input FILE]
+//            [--seed N] [--repeat R] [--output FILE] [--perf] [--memo]
+//            [--compiled DIR] [--profile DIR] [--quirks PROFILE] [--baseline FILE]
+//            [--threshold FRACTION]
+//
+// With --perf, host hardware counters (perf_counters.h) are collected around
+// every run and reported per emulated instruction.
+//
+// With --memo, frames are run through a FrameMemo (frame_memo.h) and the
+// fraction of frames replayed from it is reported as "memo_hit_rate".
+// Instructions/s then counts replayed instructions as executed.
+//
+// With --compiled, ROMs that have a shared object built by Recompile in DIR
+// (DIR/<name>.so) run its native code through CompiledRom (compiled_rom.h),
+// and "compiled" is reported for them.
+//
+// With --profile, each ROM's profile (rom_profile.h) is read from DIR before
+// it runs, for a warm start of its compiled module, and written back after an
+// extra, untimed run that records one. Recompile --profile DIR uses them.
+//
+// Each ROM runs with the QuirkProfile LoadROM() detects for it, reported as
+// "quirks", or with --quirks, every ROM with that one (modern, vip, schip or
+// xochip; see chip8.h).
+//
+// With --baseline, the run is compared against a previous output file and the
+// process exits with status 1 if any ROM lost more than --threshold (default
+// 0.10) of its throughput, or if its final framebuffer hash changed (a change
+// that is faster because it is wrong is not an improvement).
+
+#include "compiled_rom.h"
+#include "frame_memo.h"
+#include "headless.h"
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+
+struct RomResult {
+    std::string rom;
+    uint64_t instructions;
+    double seconds;
+    double instructionsPerSecond;
+    double framesPerSecond;
+    uint64_t framebufferHash;
+    Fault fault;                // The run stops early at a fault
+    QuirkProfile quirks;
+    double memoHitRate;         // Of the last repetition; negative without --memo
+    bool compiled;              // Ran a module built by Recompile
+    PerfSample perf;            // Summed over all repetitions
+    uint64_t perfInstructions;
+};
+
+struct BaselineEntry {
+    double instructionsPerSecond;
+    uint64_t framebufferHash;
+};
+
+
+static std::string EscapeJSON(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+
+static void WriteJSON(std::ostream& out, const std::vector<RomResult>& results,
+                      uint32_t frames, uint32_t cyclesPerFrame, uint32_t seed, bool perf) {
+    char numbers[200];
+
+    out << "{\"benchmark\":\"rom\",\"frames\":" << frames << ",\"cycles_per_frame\":" << cyclesPerFrame
+        << ",\"seed\":" << seed << ",\"results\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const RomResult& r = results[i];
+        snprintf(numbers, sizeof(numbers),
+                 "\"instructions\":%llu,\"seconds\":%.6f,\"instructions_per_second\":%.0f,"
+                 "\"frames_per_second\":%.1f,\"framebuffer_hash\":\"%016llx\"",
+                 static_cast<unsigned long long>(r.instructions), r.seconds, r.instructionsPerSecond,
+                 r.framesPerSecond, static_cast<unsigned long long>(r.framebufferHash));
+        out << "{\"rom\":\"" << EscapeJSON(r.rom) << "\"," << numbers;
+        if (r.fault != Fault::None) out << ",\"fault\":\"" << FaultName(r.fault) << "\"";
+        out << ",\"quirks\":\"" << QuirkProfileName(r.quirks) << "\"";
+        if (r.memoHitRate >= 0) {
+            snprintf(numbers, sizeof(numbers), ",\"memo_hit_rate\":%.4f", r.memoHitRate);
+            out << numbers;
+        }
+        if (r.compiled) out << ",\"compiled\":true";
+        if (perf) {
+            out << ",\"perf\":";
+            WritePerfJSON(out, r.perf, r.perfInstructions);
+        }
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+}
+
+
+// Reads back the one-result-per-line files written by WriteJSON().
+static bool LoadBaseline(const std::string& path, std::map<std::string, BaselineEntry>& baseline) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    auto field = [](const std::string& line, const std::string& key) -> std::string {
+        size_t start = line.find("\"" + key + "\":");
+        if (start == std::string::npos) return "";
+        start += key.size() + 3;
+        if (line[start] == '"') {
+            size_t end = start + 1;
+            while (end < line.size() && line[end] != '"') end += (line[end] == '\\') ? 2 : 1;
+            std::string value;
+            for (size_t i = start + 1; i < end; ++i) {
+                if (line[i] == '\\') ++i;
+                value += line[i];
+            }
+            return value;
+        }
+        size_t end = line.find_first_of(",}", start);
+        return line.substr(start, end - start);
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string rom = field(line, "rom");
+        if (rom.empty()) continue;
+        baseline[rom] = {std::stod(field(line, "instructions_per_second")),
+                         std::stoull(field(line, "framebuffer_hash"), nullptr, 16)};
+    }
+    return true;
+}
+
+
+static RomResult BenchROM(const std::filesystem::path& path, uint32_t frames, uint32_t cyclesPerFrame,
+                          const InputScript& script, uint32_t seed, int repeat, PerfCounters* counters,
+                          bool memo, const std::string& compiledDirectory, const std::string& profileDirectory,
+                          bool pinQuirks, QuirkProfile quirks) {
+    RomResult result{path.filename().string()};
+    result.memoHitRate = -1;
+    Chip8 chip8;
+    if (pinQuirks) chip8.SetQuirks(quirks);
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> rom{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    uint64_t romHash = Fnv1a(rom.data(), rom.size());
+
+    RomProfile profile;
+    bool warm = !profileDirectory.empty() && profile.Load(ProfilePath(profileDirectory, romHash)) &&
+                profile.romHash == romHash;
+
+    CompiledRom compiledRom;
+    if (!compiledDirectory.empty()) {
+        result.compiled = compiledRom.Open((std::filesystem::path(compiledDirectory) / (result.rom + ".so")).string(),
+                                           warm ? &profile : nullptr);
+    }
+
+    for (int r = 0; r < repeat; ++r) {
+        chip8.Seed(seed);
+        chip8.LoadROM(path.string());
+        FrameMemo frameMemo;
+
+        if (counters) counters->Start();
+        auto start = std::chrono::steady_clock::now();
+        uint64_t instructions = RunFrames(chip8, frames, cyclesPerFrame, script, memo ? &frameMemo : nullptr,
+                                          result.compiled ? &compiledRom : nullptr);
+        auto end = std::chrono::steady_clock::now();
+
+        if (counters) {
+            PerfSample sample = counters->Stop();
+            if (r == 0) result.perf = sample;
+            else Accumulate(result.perf, sample);
+            result.perfInstructions += instructions;
+        }
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (r == 0 || seconds < result.seconds) {
+            result.instructions = instructions;
+            result.seconds = seconds;
+        }
+        result.framebufferHash = FramebufferHash(chip8);
+        result.fault = chip8.LastFault();
+        result.quirks = chip8.GetQuirks();
+        if (memo) {
+            result.memoHitRate = static_cast<double>(frameMemo.Hits()) /
+                                 static_cast<double>(frameMemo.Hits() + frameMemo.Misses());
+        }
+    }
+
+    if (!profileDirectory.empty()) {
+        RomProfile recorded;
+        recorded.romHash = romHash;
+        compiledRom.Record(&recorded);
+        chip8.Seed(seed);
+        chip8.LoadROM(path.string());
+        RunFrames(chip8, frames, cyclesPerFrame, script, nullptr, &compiledRom);
+        recorded.NoteModified(chip8, rom.data(), rom.size());
+        compiledRom.Record(nullptr);
+
+        if (!recorded.Save(ProfilePath(profileDirectory, romHash))) {
+            std::cerr << "Cannot write the profile of " << result.rom << " to " << profileDirectory << std::endl;
+        }
+    }
+
+    result.instructionsPerSecond = static_cast<double>(result.instructions) / result.seconds;
+    result.framesPerSecond = frames / result.seconds;
+    return result;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string romDirectory = "../roms";
+    std::string inputPath, outputPath, baselinePath;
+    uint32_t frames = 3000;
+    uint32_t cyclesPerFrame = CYCLES_PER_FRAME;
+    uint32_t seed = 1;
+    int repeat = 3;
+    double threshold = 0.10;
+    bool perf = false;
+    bool memo = false;
+    std::string compiledDirectory, profileDirectory;
+    QuirkProfile quirks = QuirkProfile::Modern;
+    bool pinQuirks = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--roms" && hasValue) romDirectory = argv[++i];
+        else if (arg == "--frames" && hasValue) frames = std::stoul(argv[++i]);
+        else if (arg == "--cycles-per-frame" && hasValue) cyclesPerFrame = std::stoul(argv[++i]);
+        else if (arg == "--input" && hasValue) inputPath = argv[++i];
+        else if (arg == "--seed" && hasValue) seed = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && hasValue) repeat = std::stoi(argv[++i]);
+        else if (arg == "--output" && hasValue) outputPath = argv[++i];
+        else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (arg == "--threshold" && hasValue) threshold = std::stod(argv[++i]);
+        else if (arg == "--perf") perf = true;
+        else if (arg == "--memo") memo = true;
+        else if (arg == "--compiled" && hasValue) compiledDirectory = argv[++i];
+        else if (arg == "--profile" && hasValue) profileDirectory = argv[++i];
+        else if (arg == "--quirks" && hasValue && ParseQuirkProfile(argv[i + 1], quirks)) {
+            pinQuirks = true;
+            ++i;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--roms DIR] [--frames N] [--cycles-per-frame N] [--input FILE]\n"
+                      << "       [--seed N] [--repeat R] [--output FILE] [--perf] [--memo] [--compiled DIR]\n"
+                      << "       [--profile DIR] [--quirks PROFILE] [--baseline FILE] [--threshold FRACTION]"
+                      << std::endl;
+            return 2;
+        }
+    }
+    if (frames == 0 || cyclesPerFrame == 0 || repeat <= 0) {
+        std::cerr << "--frames, --cycles-per-frame and --repeat must be positive" << std::endl;
+        return 2;
+    }
+
+    InputScript script = InputScript::Default();
+    if (!inputPath.empty() && !script.LoadFile(inputPath)) {
+        std::cerr << "Cannot read input script " << inputPath << std::endl;
+        return 2;
+    }
+
+    std::vector<std::filesystem::path> roms;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(romDirectory, error)) {
+        // Hidden files are not ROMs (e.g. the catalog index, see rom_catalog.h)
+        if (entry.is_regular_file() && entry.path().filename().string()[0] != '.') roms.push_back(entry.path());
+    }
+    if (error || roms.empty()) {
+        std::cerr << "No ROMs found in " << romDirectory << std::endl;
+        return 2;
+    }
+    std::sort(roms.begin(), roms.end());
+    if (!profileDirectory.empty()) std::filesystem::create_directories(profileDirectory, error);
+
+    PerfCounters counters;
+    if (perf && !counters.Available()) {
+        std::cerr << "Hardware counters unavailable (check /proc/sys/kernel/perf_event_paranoid); "
+                     "reporting timings only" << std::endl;
+        perf = false;
+    }
+
+    std::vector<RomResult> results;
+    for (const auto& rom : roms) {
+        results.push_back(BenchROM(rom, frames, cyclesPerFrame, script, seed, repeat, perf ? &counters : nullptr,
+                                   memo, compiledDirectory, profileDirectory, pinQuirks, quirks));
+    }
+
+    if (outputPath.empty()) {
+        WriteJSON(std::cout, results, frames, cyclesPerFrame, seed, perf);
+    } else {
+        std::ofstream output(outputPath);
+        WriteJSON(output, results, frames, cyclesPerFrame, seed, perf);
+    }
+
+    if (baselinePath.empty()) return 0;
+
+    std::map<std::string, BaselineEntry> baseline;
+    if (!LoadBaseline(baselinePath, baseline)) {
+        std::cerr << "Cannot read baseline " << baselinePath << std::endl;
+        return 2;
+    }
+
+    // Report against the baseline on stderr so stdout stays valid JSON
+    bool failed = false;
+    double logRatioSum = 0;
+    int compared = 0;
+    char line[200];
+
+    for (const RomResult& r : results) {
+        auto it = baseline.find(r.rom);
+        if (it == baseline.end()) {
+            std::cerr << "  new      " << r.rom << std::endl;
+            continue;
+        }
+
+        double ratio = r.instructionsPerSecond / it->second.instructionsPerSecond;
+        logRatioSum += std::log(ratio);
+        ++compared;
+
+        const char* status = "ok";
+        if (ratio < 1.0 - threshold) {
+            status = "SLOWER";
+            failed = true;
+        }
+        if (r.framebufferHash != it->second.framebufferHash) {
+            status = "CHANGED";
+            failed = true;
+        }
+        snprintf(line, sizeof(line), "  %-8s %6.1f%%  %s", status, (ratio - 1.0) * 100.0, r.rom.c_str());
+        std::cerr << line << std::endl;
+    }
+
+    if (compared > 0) {
+        snprintf(line, sizeof(line), "Geometric mean throughput change: %+.1f%% over %d ROMs",
+                 (std::exp(logRatioSum / compared) - 1.0) * 100.0, compared);
+        std::cerr << line << std::endl;
+    }
+
+    return failed ? 1 : 0;
+}
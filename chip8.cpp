@@ -1,5 +1,8 @@
 #include "chip8.h"
 
+#include <bit>
+#include <vector>
+
 // The Chip-8 interpreter used a set of built-in fonts for
 // the hex digits 0 through F.
 // Each hexadecimal digit is represented using a 5x4 grid.
@@ -24,90 +27,501 @@ static const uint8_t chip8_font_set[FONT_SET_SIZE] = {
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// SUPER-CHIP's large digits for Fx30, 8x10 pixels each. SUPER-CHIP 1.1 only
+// had 0-9; A-F are the ones Octo added.
+static const uint8_t big_font_set[BIG_FONT_SIZE] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+const char* FaultName(Fault fault) {
+    switch (fault) {
+        case Fault::None:               return "none";
+        case Fault::InvalidOpcode:      return "invalid opcode";
+        case Fault::StackOverflow:      return "stack overflow";
+        case Fault::StackUnderflow:     return "stack underflow";
+        case Fault::MemoryOutOfRange:   return "memory access out of range";
+        case Fault::Breakpoint:         return "breakpoint";
+        case Fault::Watchpoint:         return "watchpoint";
+    }
+    return "?";
+}
+
+
+const char* QuirkProfileName(QuirkProfile profile) {
+    switch (profile) {
+        case QuirkProfile::Modern:      return "modern";
+        case QuirkProfile::CosmacVip:   return "vip";
+        case QuirkProfile::SuperChip:   return "schip";
+        case QuirkProfile::XoChip:      return "xochip";
+    }
+    return "?";
+}
+
+
+bool ParseQuirkProfile(const std::string& name, QuirkProfile& profile) {
+    for (unsigned int i = 0; i < QUIRK_PROFILE_COUNT; ++i) {
+        if (name == QuirkProfileName(static_cast<QuirkProfile>(i))) {
+            profile = static_cast<QuirkProfile>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool IsSuperChipOpcode(uint16_t op) {
+    return op == 0x00FB || op == 0x00FC || op == 0x00FD || op == 0x00FE || op == 0x00FF || (op & 0xFFF0) == 0x00C0 ||
+           (op & 0xF0FF) == 0xF030 || (op & 0xF0FF) == 0xF075 || (op & 0xF0FF) == 0xF085;
+}
+
+
+static bool IsXoChipOpcode(uint16_t op) {
+    return op == 0xF000 || op == 0xF002 || (op & 0xF0FF) == 0xF001 || (op & 0xF00F) == 0x5002 ||
+           (op & 0xF00F) == 0x5003;
+}
+
+
+// After the Fx55 or Fx65 at `offset`: is I used for memory again before
+// anything sets it, within a few straight-line instructions, in a way that
+// only makes sense if it moved past the registers? That is storing or
+// loading twice in a row, or loading right after a store, which would only
+// read back what the registers already hold. Storing back what was just
+// loaded (read-modify-write) expects I to have stayed put.
+static bool ReusesIndex(const uint8_t* rom, size_t size, size_t offset) {
+    uint8_t kind = rom[offset + 1];
+    for (size_t next = offset + 2; next + 1 < size && next <= offset + 16; next += 2) {
+        uint16_t op = rom[next] << 8 | rom[next + 1];
+        switch (op & 0xF000) {
+            case 0x0000:
+                if (op != 0x00E0) return false;
+                break;
+            case 0x1000: case 0x2000: case 0xA000: case 0xB000: case 0xD000:
+                return false;
+            case 0xF000:
+                switch (op & 0x00FF) {
+                    case 0x55: case 0x65: return kind == 0x55 || (op & 0x00FF) == kind;
+                    case 0x1E: case 0x29: case 0x30: case 0x33: return false;
+                    default: break;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+
+// Control flow is followed from 0x200 through jumps, calls and both sides of
+// every skip; Bnnn and 00EE end a path.
+QuirkProfile DetectQuirks(const uint8_t* rom, size_t size) {
+    bool schip = false, xochip = false, vip = false;
+
+    std::vector<bool> visited(size, false);
+    std::vector<size_t> pending = {0};
+
+    while (!pending.empty()) {
+        size_t offset = pending.back();
+        pending.pop_back();
+        if (offset + 1 >= size || visited[offset]) continue;
+        visited[offset] = true;
 
+        uint16_t op = rom[offset] << 8 | rom[offset + 1];
+        uint16_t target = (op & 0x0FFF) - START_INSTRUCTION_ADDRESS;   // Wraps past the ROM when below 0x200
+        unsigned int x = (op & 0x0F00) >> 8, y = (op & 0x00F0) >> 4;
 
-Chip8::Chip8()
-    : randEngine(std::chrono::system_clock::now().time_since_epoch().count())  {
+        schip |= IsSuperChipOpcode(op);
+        xochip |= IsXoChipOpcode(op);
+
+        switch (op & 0xF000) {
+            case 0x0000:
+                if (op == 0x00EE || op == 0x00FD) continue;
+                break;
+            case 0x1000:
+                pending.push_back(target);
+                continue;
+            case 0x2000:
+                pending.push_back(target);
+                break;
+            case 0x3000: case 0x4000: case 0x5000: case 0x9000:
+                pending.push_back(offset + 4);
+                break;
+            case 0x8000:
+                // Assemblers for the later interpreters write 8x06 or 8xx6
+                if (((op & 0x000F) == 0x6 || (op & 0x000F) == 0xE) && y != x && y != 0) vip = true;
+                break;
+            case 0xB000:
+                continue;
+            case 0xE000:
+                if ((op & 0x00FF) == 0x9E || (op & 0x00FF) == 0xA1) pending.push_back(offset + 4);
+                break;
+            case 0xF000:
+                if (op == 0xF000) {
+                    pending.push_back(offset + 4);      // F000 nnnn is four bytes long
+                    continue;
+                }
+                if (((op & 0x00FF) == 0x55 || (op & 0x00FF) == 0x65) && ReusesIndex(rom, size, offset)) vip = true;
+                break;
+            default:
+                break;
+        }
+        pending.push_back(offset + 2);
+    }
+
+    if (xochip) return QuirkProfile::XoChip;
+    if (schip) return QuirkProfile::SuperChip;
+    if (vip) return QuirkProfile::CosmacVip;
+    return QuirkProfile::Modern;
+}
+
+
+static_assert(MEMORY_PAGE_COUNT <= 16, "dirtyPages has one bit per page");
+
+// Memory as it is at power-on: empty apart from the font sets. The pages are
+// shared by every machine (the empty ones all point at the same zero page)
+// until they are written to or a ROM is loaded over them.
+static std::shared_ptr<const PageTable> BlankPages() {
+    static const std::shared_ptr<const PageTable> blank = [] {
+        auto table = std::make_shared<PageTable>();
+        table->fill(std::make_shared<MemoryPage>());
+
+        // Font set should be loaded into the memory at a predefined location,
+        // usually starting at address 0x50 (or 0x000 in some references).
+        auto fontPage = std::make_shared<MemoryPage>();
+        for (int i = 0; i < FONT_SET_SIZE; ++i) {
+            fontPage->bytes[i + START_FONT_SET_ADDRESS] = chip8_font_set[i];
+        }
+        static_assert(START_FONT_SET_ADDRESS + FONT_SET_SIZE <= MEMORY_PAGE_SIZE, "the font fits in page 0");
+        (*table)[0] = std::move(fontPage);
+
+        // The big font has page 1 to itself
+        auto bigFontPage = std::make_shared<MemoryPage>();
+        memcpy(bigFontPage->bytes + START_BIG_FONT_ADDRESS % MEMORY_PAGE_SIZE, big_font_set, BIG_FONT_SIZE);
+        static_assert(START_BIG_FONT_ADDRESS % MEMORY_PAGE_SIZE + BIG_FONT_SIZE <= MEMORY_PAGE_SIZE &&
+                      START_BIG_FONT_ADDRESS + BIG_FONT_SIZE <= START_INSTRUCTION_ADDRESS, "the big font fits in page 1");
+        (*table)[START_BIG_FONT_ADDRESS / MEMORY_PAGE_SIZE] = std::move(bigFontPage);
+        return table;
+    }();
+    return blank;
+}
+
+
+Chip8::Opcode Chip8::table[QUIRK_PROFILE_COUNT][0xF + 1];
+Chip8::Opcode Chip8::table0[QUIRK_PROFILE_COUNT][0xFF + 1];
+Chip8::Opcode Chip8::table8[QUIRK_PROFILE_COUNT][0xF + 1];
+Chip8::Opcode Chip8::tableE[QUIRK_PROFILE_COUNT][0xF + 1];
+Chip8::Opcode Chip8::tableF[QUIRK_PROFILE_COUNT][0xFF + 1];
+Chip8::Opcode Chip8::debugTable[QUIRK_PROFILE_COUNT][0xF + 1];
+Chip8::Opcode Chip8::debugTableF[QUIRK_PROFILE_COUNT][0xFF + 1];
+
+
+Chip8::Chip8(size_t traceDepth)
+    : trace(traceDepth) {
     // Program counter starts at 0x200 because historically the system memory up to
     // 0x1FF was reserved for the interpreter itself. Most Chip-8 programs start
     // running at location 0x200.
     pc = START_INSTRUCTION_ADDRESS;
 
-    // Font set should be loaded into the memory at a predefined location,
-    // usually starting at address 0x50 (or 0x000 in some references).
-    for (int i = 0; i < FONT_SET_SIZE; ++i) {
-        memory[i + START_FONT_SET_ADDRESS] = chip8_font_set[i];
-    }
+    resetPages = BlankPages();
+    pages = *resetPages;
 
     // Initialize random byte generator for opcode_Cxkk
+    Seed(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
     randByte = std::uniform_int_distribution<uint8_t>(0, 255);
 
-    tabulateOpcodes();
+    tabulateOnce();
 }
 
 void Chip8::Reset() {
     pc = START_INSTRUCTION_ADDRESS;
     opcode = I = sp = delayTimer = soundTimer = 0;
+    fault = Fault::None;
 
-    memset(memory, 0, RAM_SIZE);
-    memset(V, 0, REGISTER_COUNT);
-    memset(stack, 0, STACK_LEVELS);
-    memset(key, 0, KEY_COUNT);
+    // Point the pages written since the snapshot back at the snapshot's
+    for (uint16_t dirty = dirtyPages; dirty != 0; dirty &= dirty - 1) {
+        unsigned int page = std::countr_zero(dirty);
+        pages[page] = (*resetPages)[page];
+    }
+    writtenPages |= dirtyPages;
+    dirtyPages = 0;
+    ++displayWrites;
+
+    memset(V, 0, sizeof(V));
+    memset(stack, 0, sizeof(stack));
+    memset(key, 0, sizeof(key));
+    memset(rplFlags, 0, sizeof(rplFlags));
     memset(display, 0, sizeof(display));
+    hires = false;
+
+    trace.Clear();
+}
+
+
+void Chip8::Snapshot() {
+    resetPages = std::make_shared<const PageTable>(pages);
+    dirtyPages = 0;
+}
+
+
+MachineState Chip8::SaveState() const {
+    MachineState state{pages};
+    memcpy(state.V, V, sizeof(V));
+    state.pc = pc;
+    state.opcode = opcode;
+    state.I = I;
+    memcpy(state.stack, stack, sizeof(stack));
+    state.sp = sp;
+    state.fault = fault;
+    state.delayTimer = delayTimer;
+    state.soundTimer = soundTimer;
+    state.randEngine = randEngine;
+    state.randomSeed = randomSeed;
+    state.randomDraws = randomDraws;
+    state.quirks = quirks;
+    state.hires = hires;
+    memcpy(state.rplFlags, rplFlags, sizeof(rplFlags));
+    memcpy(state.display, display, sizeof(display));
+    return state;
+}
+
 
-    // Font set should be loaded into the memory at a predefined location,
-    // usually starting at address 0x50 (or 0x000 in some references).
-    for (int i = 0; i < FONT_SET_SIZE; ++i) {
-        memory[i + START_FONT_SET_ADDRESS] = chip8_font_set[i];
+void Chip8::LoadState(const MachineState& state) {
+    // Pages that are already the same are left alone, which saves the
+    // reference count traffic when going back a short way
+    for (unsigned int page = 0; page < MEMORY_PAGE_COUNT; ++page) {
+        if (pages[page] == state.pages[page]) continue;
+        pages[page] = state.pages[page];
+        writtenPages |= 1u << page;
+        if (pages[page] == (*resetPages)[page]) dirtyPages &= ~(1u << page);
+        else dirtyPages |= 1u << page;
     }
+
+    memcpy(V, state.V, sizeof(V));
+    pc = state.pc;
+    opcode = state.opcode;
+    I = state.I;
+    memcpy(stack, state.stack, sizeof(stack));
+    sp = state.sp;
+    fault = state.fault;
+    delayTimer = state.delayTimer;
+    soundTimer = state.soundTimer;
+    randEngine = state.randEngine;
+    randomSeed = state.randomSeed;
+    randomDraws = state.randomDraws;
+    quirks = state.quirks;
+    hires = state.hires;
+    memcpy(rplFlags, state.rplFlags, sizeof(rplFlags));
+    memcpy(display, state.display, sizeof(display));
+    ++displayWrites;
+    drawFlag = true;
+
+    trace.Clear();
 }
 
 
-void Chip8::LoadROM(const std::string& filename) {
-    Reset();
+void Chip8::ReadMemory(uint16_t address, uint8_t* out, size_t length) const {
+    // A page at a time, wrapping at the end of memory
+    while (length > 0) {
+        address &= RAM_SIZE - 1;
+        size_t chunk = std::min<size_t>(length, MEMORY_PAGE_SIZE - address % MEMORY_PAGE_SIZE);
+        memcpy(out, &pages[address / MEMORY_PAGE_SIZE]->bytes[address % MEMORY_PAGE_SIZE], chunk);
+        out += chunk;
+        address += chunk;
+        length -= chunk;
+    }
+}
+
+
+void Chip8::Poke(uint16_t address, uint8_t value) {
+    address &= RAM_SIZE - 1;
+    PrepareWrite(address, 1);
+    Write(address) = value;
+}
+
+
+bool Chip8::LoadROM(const std::string& filename) {
     // Open the given file in binary mode and position the file pointer at the end.
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
 
     // Check if the file was successfully opened.
-    if (file.is_open()) {
-        // Get the current position of the file pointer, which is the file size since
-        // the file was opened with the file pointer at the end.
-        std::streampos size = file.tellg();
+    if (!file.is_open()) {
+        std::cout << "Cannot open ROM: " << filename << std::endl;
+        return false;
+    }
 
-        // Allocate a buffer in memory to hold the contents of the file.
-        char* buffer = new char[size];
+    // Get the current position of the file pointer, which is the file size since
+    // the file was opened with the file pointer at the end.
+    std::streamoff size = file.tellg();
+    if (size > MAX_ROM_SIZE) {
+        std::cout << "ROM too large (" << size << " bytes, at most " << MAX_ROM_SIZE << "): " << filename << std::endl;
+        return false;
+    }
 
-        // Reposition the file pointer to the beginning of the file.
-        file.seekg(0, std::ios::beg);
+    // Read the file straight into a buffer of the right size, then load it.
+    uint8_t buffer[MAX_ROM_SIZE];
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(buffer), size);
 
-        // Read the entire file into the buffer.
-        file.read(buffer, size);
+    // A short read (the file shrank, or an I/O error) would load a truncated
+    // ROM padded with whatever was on the stack.
+    if (file.gcount() != size) {
+        std::cout << "Cannot read ROM: " << filename << std::endl;
+        return false;
+    }
 
-        // Close the file as its contents are now in the buffer, and it's no longer needed.
-        file.close();
+    return LoadROM(buffer, static_cast<size_t>(size));
+}
 
-        // Copy the file contents from the buffer to the Chip-8 memory, starting at address 512 (0x200).
-        for (int i = 0; i < size; ++i) {
-            memory[i + START_INSTRUCTION_ADDRESS] = buffer[i];
-        }
 
-        // Free the memory allocated for the buffer.
-        delete[] buffer;
+bool Chip8::LoadROM(const uint8_t* rom, size_t size) {
+    if (size > MAX_ROM_SIZE) return false;
+
+    // The new snapshot is a blank machine with the ROM copied in, starting at
+    // address 512 (0x200), in pages of its own. Every page may differ from the
+    // current memory.
+    auto table = std::make_shared<PageTable>(*BlankPages());
+    for (size_t offset = 0; offset < size; offset += MEMORY_PAGE_SIZE) {
+        auto page = std::make_shared<MemoryPage>();
+        memcpy(page->bytes, rom + offset, std::min<size_t>(MEMORY_PAGE_SIZE, size - offset));
+        (*table)[(START_INSTRUCTION_ADDRESS + offset) / MEMORY_PAGE_SIZE] = std::move(page);
     }
+    static_assert(START_INSTRUCTION_ADDRESS % MEMORY_PAGE_SIZE == 0, "ROMs start on a page boundary");
+    resetPages = std::move(table);
+    dirtyPages = (1u << MEMORY_PAGE_COUNT) - 1;
+    if (!quirksPinned) quirks = DetectQuirks(rom, size);
+
+    Reset();
+    return true;
 }
 
 
-void Chip8::Cycle() {
-    // Fetch opcode
-    opcode = memory[pc] << 8 | memory[pc + 1]; // big endian
+template <bool Debug, QuirkProfile Q>
+inline void Chip8::Step() {
+    constexpr unsigned int q = static_cast<unsigned int>(Q);
+
+    if constexpr (Debug) {
+        if (!resuming && debugPoints->breakpoints[pc & (RAM_SIZE - 1)]) {
+            fault = Fault::Breakpoint;
+            return;
+        }
+    }
+
+    // Fetch opcode. The PC wraps around the 4K address space like the
+    // interpreter's 12-bit addresses do, which also keeps the fetch in bounds.
+    opcode = Read(pc & (RAM_SIZE - 1)) << 8 | Read((pc + 1) & (RAM_SIZE - 1)); // big endian
+
+    // Record the instruction before it runs so a fault still leaves it in the trace
+    trace.Record(pc, opcode, I, V);
 
     // Increment PC before execution
     pc += 2;
 
     // Decode opcode
-    (this->*table[(opcode & 0xF000) >> 12])();
+    if constexpr (Debug) {
+        (this->*debugTable[q][(opcode & 0xF000) >> 12])();
+        resuming = false;
+
+        // A watchpoint stop is undone completely, so that Resume() replays
+        // the instruction as if it had never stopped
+        if (fault == Fault::Watchpoint) return;
+    } else {
+        (this->*table[q][(opcode & 0xF000) >> 12])();
+    }
 
     // Update timers
     if (delayTimer > 0) --delayTimer;
     if (soundTimer > 0) --soundTimer;
-}
\ No newline at end of file
+}
+
+
+template <bool Debug, QuirkProfile Q>
+Fault Chip8::Run(uint32_t count, uint32_t* executed) {
+    // Only steps that left no fault count, so a machine that has already
+    // faulted runs nothing and reports 0
+    uint32_t completed = 0;
+    while (completed < count && fault == Fault::None) {
+        Step<Debug, Q>();
+        if (fault == Fault::None) ++completed;
+    }
+    if (executed) *executed = completed;
+    return fault;
+}
+
+
+// The profile is chosen once per call, like the debug core, and not per instruction
+template <bool Debug>
+Fault Chip8::RunQuirks(uint32_t count, uint32_t* executed) {
+    switch (quirks) {
+        case QuirkProfile::Modern:      return Run<Debug, QuirkProfile::Modern>(count, executed);
+        case QuirkProfile::CosmacVip:   return Run<Debug, QuirkProfile::CosmacVip>(count, executed);
+        case QuirkProfile::SuperChip:   return Run<Debug, QuirkProfile::SuperChip>(count, executed);
+        case QuirkProfile::XoChip:      return Run<Debug, QuirkProfile::XoChip>(count, executed);
+    }
+    return fault;
+}
+
+
+// The only cost of debug points when there are none: one test per call
+Fault Chip8::Cycle() {
+    return RunCycles(1);
+}
+
+
+Fault Chip8::RunCycles(uint32_t count, uint32_t* executed) {
+    return debugPoints ? RunQuirks<true>(count, executed) : RunQuirks<false>(count, executed);
+}
+
+
+// Debug points are shared copy-on-write like the memory pages
+DebugPoints& Chip8::EditDebugPoints() {
+    if (!debugPoints) debugPoints = std::make_shared<DebugPoints>();
+    else if (debugPoints.use_count() != 1) debugPoints = std::make_shared<DebugPoints>(*debugPoints);
+    return *debugPoints;
+}
+
+
+void Chip8::SetBreakpoint(uint16_t address, bool enabled) {
+    EditDebugPoints().breakpoints.set(address & (RAM_SIZE - 1), enabled);
+    if (debugPoints->breakpoints.none() && debugPoints->readWatch.none() && debugPoints->writeWatch.none()) {
+        ClearDebugPoints();
+    }
+}
+
+
+void Chip8::SetWatchpoint(uint16_t address, uint16_t length, Watch kind, bool enabled) {
+    DebugPoints& points = EditDebugPoints();
+    for (uint16_t offset = 0; offset < length; ++offset) {
+        uint16_t watched = (address + offset) & (RAM_SIZE - 1);
+        if (static_cast<uint8_t>(kind) & static_cast<uint8_t>(Watch::Read)) points.readWatch.set(watched, enabled);
+        if (static_cast<uint8_t>(kind) & static_cast<uint8_t>(Watch::Write)) points.writeWatch.set(watched, enabled);
+    }
+    if (points.breakpoints.none() && points.readWatch.none() && points.writeWatch.none()) ClearDebugPoints();
+}
+
+
+void Chip8::ClearDebugPoints() {
+    debugPoints.reset();
+    resuming = false;
+}
+
+
+void Chip8::Resume() {
+    if (!IsDebugStop(fault)) return;
+    fault = Fault::None;
+    resuming = true;
+}
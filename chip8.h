@@ -1,37 +1,272 @@
 #pragma once
 
+#include <array>
+#include <bitset>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <random>   // for opcode Cxkk
 #include <chrono>   // for random seed
 
+#include "trace.h"
+
 const unsigned int RAM_SIZE         = 4096;
 const unsigned int REGISTER_COUNT   = 16;
-const unsigned int DISPLAY_WIDTH    = 64;
-const unsigned int DISPLAY_HEIGHT   = 32;
 const unsigned int STACK_LEVELS     = 16;
 const unsigned int KEY_COUNT        = 16;
+const unsigned int RPL_FLAG_COUNT   = 16;     // SUPER-CHIP's Fx75/Fx85 user flags
+
+// The display is 64x32 (lores), or 128x64 (hires) after the SUPER-CHIP 00FF.
+// Either way a row is held bit-packed in DISPLAY_ROW_WORDS 64-bit words, the
+// leftmost pixel in the high bit of the first word (see Chip8::Pixel()), so
+// that sprites and scrolling are a few shifts per row. Lores uses only the
+// first word of the first LORES_HEIGHT rows.
+const unsigned int LORES_WIDTH      = 64;
+const unsigned int LORES_HEIGHT     = 32;
+const unsigned int HIRES_WIDTH      = 128;
+const unsigned int HIRES_HEIGHT     = 64;
+const unsigned int DISPLAY_ROW_WORDS = HIRES_WIDTH / 64;
+
+typedef uint64_t DisplayRows[HIRES_HEIGHT][DISPLAY_ROW_WORDS];
 
 const unsigned int START_INSTRUCTION_ADDRESS    = 0x200;
 const unsigned int START_FONT_SET_ADDRESS       = 0x50;
 const unsigned int FONT_SET_SIZE                = 80;
+const unsigned int START_BIG_FONT_ADDRESS       = 0x100;    // SUPER-CHIP's 8x10 digits, for Fx30
+const unsigned int BIG_FONT_SIZE                = 160;
+const unsigned int MAX_ROM_SIZE                 = RAM_SIZE - START_INSTRUCTION_ADDRESS;
+
+// Memory is held as MEMORY_PAGE_COUNT reference-counted pages. Copies of a
+// machine share them and a page is only copied when a machine writes to it
+// while someone else still holds it (copy-on-write); Reset() just points the
+// written pages back at the snapshot.
+const unsigned int MEMORY_PAGE_SIZE     = 256;
+const unsigned int MEMORY_PAGE_COUNT    = RAM_SIZE / MEMORY_PAGE_SIZE;
+
+struct MemoryPage {
+    uint8_t bytes[MEMORY_PAGE_SIZE];
+};
+
+typedef std::array<std::shared_ptr<MemoryPage>, MEMORY_PAGE_COUNT> PageTable;
+
+// Why a machine stopped. A fault stops only the instance that raised it:
+// Cycle() and RunCycles() return it, and do nothing more until the next
+// Reset() or LoadROM().
+enum class Fault : uint8_t {
+    None,
+    InvalidOpcode,
+    StackOverflow,          // 2nnn with all STACK_LEVELS in use
+    StackUnderflow,         // 00EE with an empty stack
+    MemoryOutOfRange,       // Dxyn, Fx33, Fx55 or Fx65 reaching past the end of memory
+    Breakpoint,             // About to execute an instruction with a breakpoint on it
+    Watchpoint              // About to access a watched address; see Chip8::WatchHit()
+};
+
+const char* FaultName(Fault fault);
+
+// Where the CHIP-8 implementations disagree. The defaults are what this
+// emulator has always done; the other profiles follow the machines and
+// interpreters the ROMs were written for.
+struct Quirks {
+    bool shiftReadsVy;              // 8xy6/8xyE shift Vy into Vx, rather than Vx in place
+    bool loadStoreIncrementsI;      // Fx55/Fx65 leave I past the last register
+    bool jumpUsesVx;                // Bxnn jumps to xnn + Vx, rather than Bnnn to nnn + V0
+    bool logicResetsVF;             // 8xy1/8xy2/8xy3 clear VF
+    bool wrapSprites;               // Dxyn wraps sprites around the edges instead of clipping them
+    bool superChipOpcodes;          // 00Cn, 00FB-00FF, Fx30, Fx75/Fx85 and 16x16 Dxy0 sprites exist
+};
+
+enum class QuirkProfile : uint8_t {
+    Modern,                         // None of the quirks
+    CosmacVip,                      // The original interpreter on the COSMAC VIP
+    SuperChip,                      // SUPER-CHIP 1.1 on the HP 48
+    XoChip                          // Octo's XO-CHIP
+};
+
+const unsigned int QUIRK_PROFILE_COUNT = 4;
+
+constexpr Quirks QUIRK_PROFILES[QUIRK_PROFILE_COUNT] = {
+    {false, false, false, false, false, false},
+    {true,  true,  false, true,  false, false},
+    {false, false, true,  false, false, true},
+    {true,  true,  false, false, true,  true}
+};
+
+constexpr const Quirks& QuirksOf(QuirkProfile profile) { return QUIRK_PROFILES[static_cast<unsigned int>(profile)]; }
+
+const char* QuirkProfileName(QuirkProfile profile);
+
+// By QuirkProfileName(); false if there is no profile of that name
+bool ParseQuirkProfile(const std::string& name, QuirkProfile& profile);
+
+// Guess the profile a ROM was written for from the instructions reachable
+// from its entry point (sprite data can look like anything):
+//   - XO-CHIP instructions (F000 nnnn, F002, Fx01, 5xy2, 5xy3): xochip
+//   - SUPER-CHIP instructions (00FE/00FF, scrolling, Fx30, Fx75/Fx85): schip
+//   - 8xy6/8xyE shifting another register (y not x or 0), or Fx55/Fx65
+//     followed by another store or load without I being reloaded (except
+//     storing back what was just loaded): vip
+//   - otherwise modern.
+// A few microseconds for the largest ROM; LoadROM() calls it.
+QuirkProfile DetectQuirks(const uint8_t* rom, size_t size);
+
+// Breakpoint and watchpoint stops are not errors: Chip8::Resume() carries on.
+[[nodiscard]] inline bool IsDebugStop(Fault fault) { return fault == Fault::Breakpoint || fault == Fault::Watchpoint; }
+
+
+// Execution breakpoints and memory watchpoints, one bit per address
+struct DebugPoints {
+    std::bitset<RAM_SIZE> breakpoints;
+    std::bitset<RAM_SIZE> readWatch;        // Sprite fetches (Dxyn) and Fx65
+    std::bitset<RAM_SIZE> writeWatch;       // Fx33 and Fx55
+};
+
+enum class Watch : uint8_t {
+    Read    = 1,
+    Write   = 2,
+    Access  = Read | Write
+};
+
+
+// Everything that determines what a machine does next, apart from its keys
+// (see Chip8::SaveState()). The memory pages are shared with the machine
+// copy-on-write, so a saved state costs a page table and a framebuffer, not a
+// copy of memory.
+struct MachineState {
+    PageTable pages;
+    uint8_t V[REGISTER_COUNT];
+    uint16_t pc, opcode, I;
+    uint16_t stack[STACK_LEVELS];
+    uint16_t sp;
+    Fault fault;
+    uint8_t delayTimer, soundTimer;
+    std::default_random_engine randEngine;
+    uint32_t randomSeed, randomDraws;
+    QuirkProfile quirks;
+    bool hires;
+    uint8_t rplFlags[RPL_FLAG_COUNT];
+    DisplayRows display;
+};
 
 
 class Chip8 {
 public:
-    Chip8();
+    // traceDepth is the number of instructions the trace keeps (rounded up to a power of two)
+    explicit Chip8(size_t traceDepth = TRACE_DEPTH);
+
+    // Copying a machine is cheap: memory pages are shared copy-on-write and the
+    // dispatch tables are static. The copy starts with an empty trace (see
+    // InstructionTrace), so a copy-assignment into an existing machine
+    // allocates nothing. MachineArena builds on this for tree search.
+    Chip8(const Chip8&) = default;
+    Chip8& operator=(const Chip8&) = default;
+
+    // Both return false, leaving the machine untouched, if the ROM cannot be
+    // read or does not fit in memory (MAX_ROM_SIZE bytes). Unless SetQuirks()
+    // pinned a profile, the ROM runs with the one DetectQuirks() picks for it.
+    bool LoadROM(const std::string& filename);
+    bool LoadROM(const uint8_t* rom, size_t size);
+
+    // Execute one instruction, or up to `count` of them, stopping early at a
+    // fault. `executed` receives the number of instructions that completed
+    // (0 if the machine had already faulted).
+    // A faulting instruction leaves the PC pointing at itself.
+    Fault Cycle();
+    Fault RunCycles(uint32_t count, uint32_t* executed = nullptr);
 
-    void LoadROM(const std::string& filename);
-    void Cycle();
+    // Select the behaviour where the variants disagree (see Quirks). It holds
+    // until changed, across LoadROM() and Reset(); AutoQuirks() goes back to
+    // detecting it at the next LoadROM(). Each profile runs its own
+    // instantiation of the core, so the handlers never test a quirk at run time.
+    void SetQuirks(QuirkProfile profile) {
+        quirks = profile;
+        quirksPinned = true;
+    }
+    void AutoQuirks() { quirksPinned = false; }
+    [[nodiscard]] QuirkProfile GetQuirks() const { return quirks; }
+
+    // Restart the program: registers, stack, timers, keys, RPL flags and
+    // display are cleared (back to lores) and memory goes back to the last
+    // snapshot. Only the pages written since then are copied back, so a reset
+    // costs little more than what the program actually changed.
     void Reset();
 
-    uint8_t display[DISPLAY_WIDTH * DISPLAY_HEIGHT]{};  // Monochrome display of 64x32 pixels (2048 pixels total)
+    // Make the current memory the state Reset() returns to. LoadROM() takes a
+    // snapshot of the freshly loaded ROM, so this is only needed to start from
+    // a patched image (e.g. a fuzzer or search that reset millions of times).
+    // Only the page table is copied; the pages become shared.
+    void Snapshot();
+
+    // Reseed the RNG behind opcode_Cxkk. The constructor seeds from the clock;
+    // headless runs reseed so that they are reproducible.
+    void Seed(uint32_t seed) {
+        randEngine.seed(seed);
+        randomSeed = seed;
+        randomDraws = 0;
+    }
+
+    // Capture the machine, or put it back exactly as it was captured (the keys
+    // are left alone, being input rather than state). The trace starts over.
+    [[nodiscard]] MachineState SaveState() const;
+    void LoadState(const MachineState& state);
+
+    // Dump the last TRACE_DEPTH executed instructions as plain text or as
+    // Chrome trace_event JSON (load it in chrome://tracing or ui.perfetto.dev).
+    void DumpTrace(std::ostream& out) const { trace.DumpText(out, V); }
+    void DumpTraceJSON(std::ostream& out) const { trace.DumpChromeJSON(out, V); }
+
+    // Read-only view of the machine state for tools and debuggers
+    [[nodiscard]] uint16_t PC() const { return pc; }
+    [[nodiscard]] uint16_t Index() const { return I; }
+    [[nodiscard]] uint16_t SP() const { return sp; }
+    [[nodiscard]] const uint8_t* Registers() const { return V; }
+    [[nodiscard]] const uint16_t* Stack() const { return stack; }
+    [[nodiscard]] uint8_t DelayTimer() const { return delayTimer; }
+    [[nodiscard]] uint8_t SoundTimer() const { return soundTimer; }
+    [[nodiscard]] uint8_t Peek(uint16_t address) const { return Read(address & (RAM_SIZE - 1)); }
+    void ReadMemory(uint16_t address, uint8_t* out, size_t length) const;
+    [[nodiscard]] uint16_t CurrentOpcode() const { return opcode; }   // Last one fetched
+    [[nodiscard]] Fault LastFault() const { return fault; }
+
+    [[nodiscard]] bool HiRes() const { return hires; }
+    [[nodiscard]] unsigned int DisplayWidth() const { return hires ? HIRES_WIDTH : LORES_WIDTH; }
+    [[nodiscard]] unsigned int DisplayHeight() const { return hires ? HIRES_HEIGHT : LORES_HEIGHT; }
+    [[nodiscard]] bool Pixel(unsigned int x, unsigned int y) const { return display[y][x / 64] >> (63 - x % 64) & 1; }
+
+    // False if the opcode decodes to opcode_NONE in the given profile
+    [[nodiscard]] static bool IsValidOpcode(uint16_t op, QuirkProfile profile);
+
+    // Write a byte of memory from outside the program (a debugger, a tool)
+    void Poke(uint16_t address, uint8_t value);
+
+    // Breakpoints stop the machine before the instruction at `address` runs,
+    // watchpoints before an instruction reads or writes a watched byte; both
+    // with the PC on that instruction. Resume() clears the stop and runs the
+    // instruction without stopping on it again. Copies of a machine share its
+    // debug points until one of them changes its own.
+    //
+    // They cost nothing while none are set: the core then runs exactly as it
+    // would without them. With any set, Cycle() and RunCycles() switch to a
+    // second instantiation of the core whose dispatch tables route the memory
+    // opcodes through watchpoint checks.
+    void SetBreakpoint(uint16_t address, bool enabled = true);
+    void SetWatchpoint(uint16_t address, uint16_t length, Watch kind, bool enabled = true);
+    void ClearDebugPoints();
+    [[nodiscard]] const DebugPoints* GetDebugPoints() const { return debugPoints.get(); }
+    void Resume();
+    [[nodiscard]] uint16_t WatchHit() const { return watchHit; }        // Address that raised the last Watchpoint
+
+    DisplayRows display{};                              // Monochrome, bit-packed rows (see DISPLAY_ROW_WORDS)
     uint8_t key[KEY_COUNT]{};                           // Represents state of 16 keys; 0/1 = unpressed/pressed
 
     bool drawFlag{};                                    // Signal to draw
 
 private:
-    uint8_t memory[RAM_SIZE]{};                         // 4K memory of the Chip-8 system
+    friend class OpcodeBench;                           // bench/opcode_bench.cpp times the handlers in isolation
+    friend class FrameMemo;                             // Hashes the state incrementally, see frame_memo.h
+    friend class CompiledRom;                           // Runs recompiled blocks on the registers, see compiled_rom.h
+
+    PageTable pages;                                    // 4K memory of the Chip-8 system, see MemoryPage
     uint8_t V[REGISTER_COUNT]{};                        // 16 general-purpose 8-bit registers. VF doubles as a flag.
 
     uint16_t pc;                                        // Program counter
@@ -41,11 +276,53 @@ private:
     uint16_t stack[STACK_LEVELS]{};                     // Stack for storing return addresses
     uint16_t sp{};                                      // Stack pointer
 
+    Fault fault{};                                      // Set by Raise(); the machine is stopped until Reset()
+
     uint8_t delayTimer{};                               // Delay timer, decrements at 60Hz when set to a value above 0
     uint8_t soundTimer{};                               // Sound timer, system beeps when this timer reaches 0
 
+    bool hires{};                                       // 128x64 display (SUPER-CHIP 00FF) rather than 64x32
+    uint8_t rplFlags[RPL_FLAG_COUNT]{};                 // Written and read by Fx75/Fx85
+
     std::default_random_engine randEngine;              // RNG (see opcode_Cxkk)
     std::uniform_int_distribution<uint8_t> randByte;    // Random byte generator (see opcode_Cxkk)
+    uint32_t randomSeed{};                              // Together these identify the state of randEngine
+    uint32_t randomDraws{};                             // Bytes drawn since Seed()
+
+    QuirkProfile quirks{};                              // Selects the instantiation Run() uses
+    bool quirksPinned{};                                // By SetQuirks(); LoadROM() leaves quirks alone
+
+    InstructionTrace trace;                             // Ring buffer of recently executed instructions
+
+    std::shared_ptr<const PageTable> resetPages;        // What Reset() restores memory to; shared by copies
+    uint16_t dirtyPages{};                              // One bit per page that differs from resetPages
+
+    std::shared_ptr<DebugPoints> debugPoints;           // Null while none are set
+    bool resuming{};                                    // Run the next instruction without stopping on it
+    uint16_t watchHit{};
+
+    // Change tracking for FrameMemo: a bit per page that may have changed since
+    // FrameMemo last looked, and a count of writes to the display
+    uint16_t writtenPages{};
+    uint32_t displayWrites{};
+
+    // address must be below RAM_SIZE
+    [[nodiscard]] uint8_t Read(uint16_t address) const {
+        return pages[address / MEMORY_PAGE_SIZE]->bytes[address % MEMORY_PAGE_SIZE];
+    }
+    uint8_t& Write(uint16_t address) { return pages[address / MEMORY_PAGE_SIZE]->bytes[address % MEMORY_PAGE_SIZE]; }
+
+    // Every write to memory is preceded by this (Fx33 and Fx55 are the only
+    // opcodes that write): pages still shared with another machine or with
+    // the snapshot are copied first, and marked so that Reset() restores them.
+    void PrepareWrite(uint16_t address, unsigned int length) {
+        unsigned int last = (address + length - 1) / MEMORY_PAGE_SIZE;
+        for (unsigned int page = address / MEMORY_PAGE_SIZE; page <= last; ++page) {
+            if (pages[page].use_count() != 1) pages[page] = std::make_shared<MemoryPage>(*pages[page]);
+            dirtyPages |= 1u << page;
+            writtenPages |= 1u << page;
+        }
+    }
 
     // I tabularize the opcodes in accordance with the technique discussed by
     // Austin Morlan in his CHIP-8 tutorial (see README). Each table consists
@@ -53,17 +330,51 @@ private:
     // function pointers to Table0, Table8, TableE and TableF for further decoding
     // of an opcode via a bitmask if needed.
 
+    //
+    // The tables are the same for every machine, so they are static and filled
+    // in once, by the first constructor. There is a set per QuirkProfile, in
+    // which the quirky opcodes point at that profile's instantiation.
+
     typedef void (Chip8::*Opcode)();
-    Opcode table[0xF + 1]{};
-    Opcode table0[0xE + 1]{};
-    Opcode table8[0xE + 1]{};
-    Opcode tableE[0xE + 1]{};
-    Opcode tableF[0x65 + 1]{};
-    void Table0();
-    void Table8();
-    void TableE();
-    void TableF();
-    void tabulateOpcodes();
+    static Opcode table[QUIRK_PROFILE_COUNT][0xF + 1];
+    static Opcode table0[QUIRK_PROFILE_COUNT][0xFF + 1];
+    static Opcode table8[QUIRK_PROFILE_COUNT][0xF + 1];
+    static Opcode tableE[QUIRK_PROFILE_COUNT][0xF + 1];
+    static Opcode tableF[QUIRK_PROFILE_COUNT][0xFF + 1];
+
+    // The debug core's tables: table and tableF with the memory opcodes
+    // replaced by watchpoint-checking versions
+    static Opcode debugTable[QUIRK_PROFILE_COUNT][0xF + 1];
+    static Opcode debugTableF[QUIRK_PROFILE_COUNT][0xFF + 1];
+
+    template <bool Debug, QuirkProfile Q> void Step();
+    template <bool Debug, QuirkProfile Q> Fault Run(uint32_t count, uint32_t* executed);
+    template <bool Debug> Fault RunQuirks(uint32_t count, uint32_t* executed);
+
+    // Stop the machine at the current instruction (which has already moved
+    // the PC past itself). Only the handlers that can fault call this, so
+    // valid instructions pay nothing for it.
+    void Raise(Fault reason) {
+        fault = reason;
+        pc -= 2;
+    }
+
+    template <QuirkProfile Q> void Table0();
+    template <QuirkProfile Q> void Table8();
+    template <QuirkProfile Q> void TableE();
+    template <QuirkProfile Q> void TableF();
+    template <QuirkProfile Q> void DebugTableF();
+    static void tabulateOpcodes();
+    static void tabulateOnce();
+    template <QuirkProfile Q> static void tabulateProfile();
+
+    DebugPoints& EditDebugPoints();
+    [[nodiscard]] bool Watched(const std::bitset<RAM_SIZE>& watch, uint16_t address, unsigned int length);
+    template <QuirkProfile Q> [[nodiscard]] unsigned int SpriteBytes() const;
+    template <QuirkProfile Q> void watched_Dxyn();
+    void watched_Fx33();
+    template <QuirkProfile Q> void watched_Fx55();
+    template <QuirkProfile Q> void watched_Fx65();
 
     // Opcodes===========================================================================
     // "The original implementation of the Chip-8 language includes 36 different
@@ -79,23 +390,32 @@ private:
     // each instruction above each implementation. Verbosity in comments stems from my
     // own ignorance of emulation and a desire to deepen my understanding of it.
 
-    void opcode_00E0();     void opcode_8xyE();     void opcode_NONE();
-    void opcode_00EE();     void opcode_9xy0();
-    void opcode_1nnn();     void opcode_Annn();
-    void opcode_2nnn();     void opcode_Bnnn();
-    void opcode_3xkk();     void opcode_Cxkk();
-    void opcode_4xkk();     void opcode_Dxyn();
-    void opcode_5xy0();     void opcode_Ex9E();
-    void opcode_6xkk();     void opcode_ExA1();
-    void opcode_7xkk();     void opcode_Fx07();
-    void opcode_8xy0();     void opcode_Fx0A();
-    void opcode_8yx1();     void opcode_Fx15();
-    void opcode_8xy2();     void opcode_Fx18();
-    void opcode_8xy3();     void opcode_Fx1E();
-    void opcode_8xy4();     void opcode_Fx29();
-    void opcode_8xy5();     void opcode_Fx33();
-    void opcode_8xy6();     void opcode_Fx65();
-    void opcode_8xy7();     void opcode_Fx55();
+    void opcode_00E0();     void opcode_8xy7();     void opcode_Ex9E();
+    void opcode_00EE();     void opcode_9xy0();     void opcode_ExA1();
+    void opcode_1nnn();     void opcode_Annn();     void opcode_Fx07();
+    void opcode_2nnn();     void opcode_Cxkk();     void opcode_Fx0A();
+    void opcode_3xkk();     void opcode_Fx15();     void opcode_Fx18();
+    void opcode_4xkk();     void opcode_Fx1E();     void opcode_Fx29();
+    void opcode_5xy0();     void opcode_Fx33();     void opcode_NONE();
+    void opcode_6xkk();     void opcode_8xy4();
+    void opcode_7xkk();     void opcode_8xy5();
+    void opcode_8xy0();
+
+    // SUPER-CHIP, in the profiles with superChipOpcodes
+    void opcode_00Cn();     void opcode_00FD();     void opcode_Fx30();
+    void opcode_00FB();     void opcode_00FE();     void opcode_Fx75();
+    void opcode_00FC();     void opcode_00FF();     void opcode_Fx85();
+
+    // The opcodes where the variants disagree are instantiated per QuirkProfile
+    template <QuirkProfile Q> void opcode_8yx1();
+    template <QuirkProfile Q> void opcode_8xy2();
+    template <QuirkProfile Q> void opcode_8xy3();
+    template <QuirkProfile Q> void opcode_8xy6();
+    template <QuirkProfile Q> void opcode_8xyE();
+    template <QuirkProfile Q> void opcode_Bnnn();
+    template <QuirkProfile Q> void opcode_Dxyn();
+    template <QuirkProfile Q> void opcode_Fx55();
+    template <QuirkProfile Q> void opcode_Fx65();
 
     // Opcode Utility Functions=========================================================
     // These are helper functions designed to aid with the extraction of information
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// The interface between the core and a ROM compiled ahead of time by the
+// Recompile tool (see recompiler.h and compiled_rom.h). The generated code
+// includes only this header, so that it can be built on its own with the
+// system compiler; the core binds a machine to a CompiledMachine and calls
+// the generated block functions with it.
+//
+// Bump CHIP8_COMPILED_ABI whenever anything here changes: modules built
+// against another version are refused.
+
+#define CHIP8_COMPILED_ABI 2
+
+extern "C" {
+
+// Pointers into the machine being run
+struct CompiledMachine {
+    uint8_t* V;
+    uint16_t* I;
+    uint16_t* pc;
+    uint16_t* stack;
+    uint16_t* sp;
+    uint8_t* delayTimer;
+    uint8_t* soundTimer;
+    const uint8_t* key;
+
+    // Execute the instruction at *pc in the interpreter. Returns the PC it
+    // leaves, or -1 if it faulted.
+    int (*interpret)(struct CompiledMachine* machine);
+    void* chip8;
+};
+
+// Run a basic block, executing at most `budget` (> 0) instructions. Returns
+// the number that completed and leaves *pc on the next one to execute.
+typedef uint32_t (*CompiledBlockFunction)(struct CompiledMachine* machine, uint32_t budget);
+
+struct CompiledBlock {
+    uint16_t start;
+    uint16_t length;                // In instructions
+    CompiledBlockFunction run;      // From the start, with a budget of at least `length`
+    CompiledBlockFunction partial;  // From any of its instructions, with any budget
+};
+
+struct CompiledModule {
+    uint32_t abi;                   // CHIP8_COMPILED_ABI
+    uint32_t romSize;
+    const uint8_t* rom;             // The image the code was generated from
+    uint32_t quirks;                // The QuirkProfile it was generated for
+    uint32_t blockCount;
+    const struct CompiledBlock* blocks;
+};
+
+// The one symbol a compiled ROM exports
+typedef const struct CompiledModule* (*CompiledModuleEntry)(void);
+#define CHIP8_COMPILED_ENTRY "chip8_compiled_module"
+
+}
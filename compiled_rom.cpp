@@ -0,0 +1,172 @@
+#include "compiled_rom.h"
+
+#include <cstring>
+#include <dlfcn.h>
+
+CompiledRom::~CompiledRom() {
+    Close();
+}
+
+
+bool CompiledRom::Open(const std::string& path, const RomProfile* profile) {
+    Close();
+
+    // RTLD_LOCAL: every module exports the same entry point
+    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) return false;
+
+    auto entry = reinterpret_cast<CompiledModuleEntry>(dlsym(handle, CHIP8_COMPILED_ENTRY));
+    const CompiledModule* loaded = entry ? entry() : nullptr;
+    if (!loaded || loaded->abi != CHIP8_COMPILED_ABI || loaded->romSize > MAX_ROM_SIZE ||
+        loaded->quirks >= QUIRK_PROFILE_COUNT) {
+        Close();
+        return false;
+    }
+
+    module = loaded;
+    // A block owns its start address; the rest of its instructions go to it
+    // unless another block starts there (code that jumps into a block makes
+    // the analysis start a new one, so this is rare)
+    blockAt.assign(RAM_SIZE, nullptr);
+    for (uint32_t i = 0; i < module->blockCount; ++i) {
+        const CompiledBlock& block = module->blocks[i];
+        for (unsigned int k = 1; k < block.length && block.start + 2 * k < RAM_SIZE; ++k) {
+            if (!blockAt[block.start + 2 * k]) blockAt[block.start + 2 * k] = &block;
+        }
+    }
+    for (uint32_t i = 0; i < module->blockCount; ++i) {
+        const CompiledBlock& block = module->blocks[i];
+        if (block.start < RAM_SIZE) blockAt[block.start] = &block;
+    }
+
+    if (profile) {
+        // Self-modified code would fail the check in RunCycles() every time
+        for (const CompiledBlock*& block : blockAt) {
+            if (!block) continue;
+            for (unsigned int address = block->start; address < block->start + 2u * block->length; ++address) {
+                if (address < RAM_SIZE && profile->modified[address]) {
+                    block = nullptr;
+                    break;
+                }
+            }
+        }
+        Prefault(*profile);
+    }
+    return true;
+}
+
+
+// dlopen() maps the module, but its pages are only read in when first
+// executed, in the middle of a frame. Reading the first byte of every block
+// the profile saw run does that up front; the hottest blocks are generated
+// next to each other (see recompiler.h), so this is a handful of pages.
+void CompiledRom::Prefault(const RomProfile& profile) const {
+    uint8_t sum = 0;
+    for (uint16_t address : profile.Hot()) {
+        const CompiledBlock* block = blockAt[address];
+        if (!block || block->start != address) continue;
+        sum += *reinterpret_cast<const volatile uint8_t*>(reinterpret_cast<uintptr_t>(block->run));
+        sum += *reinterpret_cast<const volatile uint8_t*>(reinterpret_cast<uintptr_t>(block->partial));
+    }
+    (void)sum;
+}
+
+
+void CompiledRom::Close() {
+    module = nullptr;
+    blockAt.clear();
+    if (handle) dlclose(handle);
+    handle = nullptr;
+}
+
+
+bool CompiledRom::Matches(const uint8_t* rom, size_t size) const {
+    return module && size == module->romSize && memcmp(rom, module->rom, size) == 0;
+}
+
+
+// Blocks are a few instructions long and rarely cross a page, so this is one memcmp
+bool CompiledRom::Unchanged(const Chip8& chip8, uint16_t pc, const CompiledBlock& block) const {
+    unsigned int length = block.start + 2 * block.length - pc;
+    const uint8_t* compiled = module->rom + (pc - START_INSTRUCTION_ADDRESS);
+    unsigned int page = pc / MEMORY_PAGE_SIZE, offset = pc % MEMORY_PAGE_SIZE;
+
+    if (offset + length <= MEMORY_PAGE_SIZE) return memcmp(chip8.pages[page]->bytes + offset, compiled, length) == 0;
+    for (unsigned int i = 0; i < length; ++i) {
+        if (chip8.Read(pc + i) != compiled[i]) return false;
+    }
+    return true;
+}
+
+
+// Fallback for the instructions a block leaves to the interpreter
+static int Interpret(CompiledMachine* machine) {
+    auto* chip8 = static_cast<Chip8*>(machine->chip8);
+    return chip8->Cycle() == Fault::None ? chip8->PC() : -1;
+}
+
+
+CompiledMachine CompiledRom::Bind(Chip8& chip8) {
+    return {chip8.V, &chip8.I, &chip8.pc, chip8.stack, &chip8.sp, &chip8.delayTimer, &chip8.soundTimer, chip8.key,
+            Interpret, &chip8};
+}
+
+
+Fault CompiledRom::RunCycles(Chip8& chip8, uint32_t count, uint32_t* executed) const {
+    if (recording && !chip8.debugPoints && chip8.fault == Fault::None) return RunRecorded(chip8, count, executed);
+    if (!module || chip8.debugPoints || chip8.fault != Fault::None || !Compatible(chip8)) {
+        return chip8.RunCycles(count, executed);
+    }
+
+    CompiledMachine machine = Bind(chip8);
+
+    uint32_t done = 0;
+    while (done < count) {
+        const CompiledBlock* block = chip8.pc < RAM_SIZE ? blockAt[chip8.pc] : nullptr;
+        if (block && Unchanged(chip8, chip8.pc, *block)) {
+            bool whole = chip8.pc == block->start && block->length <= count - done;
+            done += (whole ? block->run : block->partial)(&machine, count - done);
+        } else {
+            if (chip8.Cycle() == Fault::None) ++done;
+        }
+        if (chip8.fault != Fault::None) break;
+    }
+
+    if (executed) *executed = done;
+    return chip8.fault;
+}
+
+
+// RunCycles() with the profile counting. Kept apart so that the normal loop
+// does not test for it.
+Fault CompiledRom::RunRecorded(Chip8& chip8, uint32_t count, uint32_t* executed) const {
+    CompiledMachine machine = Bind(chip8);
+    bool compatible = module && Compatible(chip8);
+
+    uint32_t done = 0;
+    while (done < count) {
+        uint16_t pc = chip8.pc;
+        const CompiledBlock* block = compatible && pc < RAM_SIZE ? blockAt[pc] : nullptr;
+        uint32_t ran;
+
+        if (block && Unchanged(chip8, pc, *block)) {
+            bool whole = pc == block->start && block->length <= count - done;
+            ran = (whole ? block->run : block->partial)(&machine, count - done);
+        } else {
+            if (block) {
+                for (unsigned int address = pc; address < block->start + 2u * block->length; ++address) {
+                    if (chip8.Read(address) != module->rom[address - START_INSTRUCTION_ADDRESS]) {
+                        recording->modified.set(address);
+                    }
+                }
+            }
+            ran = chip8.Cycle() == Fault::None ? 1 : 0;
+        }
+        recording->Count(pc, ran);
+        done += ran;
+        if (chip8.fault != Fault::None) break;
+    }
+
+    if (executed) *executed = done;
+    return chip8.fault;
+}
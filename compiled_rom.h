@@ -0,0 +1,75 @@
+#pragma once
+
+#include "chip8.h"
+#include "compiled_abi.h"
+#include "rom_profile.h"
+
+#include <string>
+#include <vector>
+
+// A ROM recompiled ahead of time to native code (see recompiler.h), loaded
+// from the shared object the Recompile tool builds.
+//
+//   CompiledRom compiled;
+//   if (compiled.Open("PONG.so")) compiled.RunCycles(chip8, cycles);
+//
+// RunCycles() is a drop-in for Chip8::RunCycles(): it runs native code where
+// it can and the interpreter everywhere else, with the same results
+// instruction for instruction. Blocks can be entered at any instruction and
+// stop when the cycle count runs out, so frame boundaries cost nothing. The
+// interpreter takes over
+//   - where no block covers the PC (code only reached through Bnnn/00EE, or
+//     code outside the ROM),
+//   - for a block whose bytes in memory differ from the ROM it was compiled
+//     from, so self-modifying code and other ROMs are safe,
+//   - and for the whole run while the machine has debug points, or runs
+//     with other quirks than the module was compiled for (see Chip8::SetQuirks()).
+// The instruction trace only records the interpreted instructions.
+//
+// Warm start: Open() with the profile of an earlier run (rom_profile.h) drops
+// the blocks that run saw modified, so they go straight to the interpreter,
+// and touches the code of the blocks it saw run, so the first frame does not
+// pay for faulting them in. Record() collects such a profile; it also works
+// with no module open, which is how a ROM gets its first profile.
+
+class CompiledRom {
+public:
+    CompiledRom() = default;
+    ~CompiledRom();
+
+    CompiledRom(const CompiledRom&) = delete;
+    CompiledRom& operator=(const CompiledRom&) = delete;
+
+    // False if the file cannot be loaded or was built for another ABI
+    bool Open(const std::string& path, const RomProfile* profile = nullptr);
+    void Close();
+
+    // Count what RunCycles() executes into `profile` (null to stop)
+    void Record(RomProfile* profile) { recording = profile; }
+
+    [[nodiscard]] bool IsOpen() const { return module != nullptr; }
+    [[nodiscard]] size_t BlockCount() const { return module ? module->blockCount : 0; }
+
+    // True if the module was compiled from this ROM image
+    [[nodiscard]] bool Matches(const uint8_t* rom, size_t size) const;
+    [[nodiscard]] QuirkProfile Quirks() const { return module ? static_cast<QuirkProfile>(module->quirks) : QuirkProfile{}; }
+
+    Fault RunCycles(Chip8& chip8, uint32_t count, uint32_t* executed = nullptr) const;
+
+private:
+    void* handle{};
+    const CompiledModule* module{};
+    std::vector<const CompiledBlock*> blockAt;     // RAM_SIZE entries, null where no block has an instruction
+    RomProfile* recording{};
+
+    static CompiledMachine Bind(Chip8& chip8);
+    void Prefault(const RomProfile& profile) const;
+    Fault RunRecorded(Chip8& chip8, uint32_t count, uint32_t* executed) const;
+
+    [[nodiscard]] bool Compatible(const Chip8& chip8) const {
+        return module->quirks == static_cast<uint32_t>(chip8.quirks);
+    }
+
+    // The code from `pc` to the end of the block is what it was compiled from
+    [[nodiscard]] bool Unchanged(const Chip8& chip8, uint16_t pc, const CompiledBlock& block) const;
+};
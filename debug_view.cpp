@@ -0,0 +1,160 @@
+#include "debug_view.h"
+#include "disassembler.h"
+
+#include <cstdio>
+
+static tgui::Label::Ptr MakeRowLabel(tgui::Gui& gui, float x, float y) {
+    auto label = tgui::Label::create();
+    label->setPosition(x, y);
+    label->setTextSize(13);
+    label->getRenderer()->setTextColor(tgui::Color::White);
+    gui.add(label);
+    return label;
+}
+
+
+void DebugView::Create(tgui::Gui& gui, Chip8& machine, float top) {
+    chip8 = &machine;
+
+    for (unsigned int row = 0; row < HEX_ROWS; ++row) {
+        hexRows[row].label = MakeRowLabel(gui, 10, top + 10 + row * DEBUG_ROW_HEIGHT);
+    }
+
+    hexScrollbar = tgui::Scrollbar::create();
+    hexScrollbar->setPosition(400, top + 10);
+    hexScrollbar->setSize(16, HEX_ROWS * DEBUG_ROW_HEIGHT);
+    hexScrollbar->setMaximum(RAM_SIZE / HEX_BYTES_PER_ROW);
+    hexScrollbar->setViewportSize(HEX_ROWS);
+    hexScrollbar->setValue(START_INSTRUCTION_ADDRESS / HEX_BYTES_PER_ROW);
+    hexScrollbar->onValueChange([this] {
+        for (HexRow& row : hexRows) row.valid = false;
+        RefreshHex();
+    });
+    gui.add(hexScrollbar);
+
+    for (unsigned int row = 0; row < CODE_ROWS; ++row) {
+        codeRows[row].label = MakeRowLabel(gui, 440, top + 10 + row * DEBUG_ROW_HEIGHT);
+        codeRows[row].label->onClick([this, row] { ToggleBreakpoint(row); });
+    }
+
+    // To the right of the game view, under the ROM selector
+    registerLabel = MakeRowLabel(gui, 660, 60);
+
+    Refresh();
+}
+
+
+void DebugView::SetAnalysis(const RomAnalysis* romAnalysis) {
+    analysis = romAnalysis;
+    for (CodeRow& row : codeRows) row.valid = false;
+}
+
+
+void DebugView::Refresh() {
+    RefreshHex();
+    RefreshCode();
+    RefreshRegisters();
+}
+
+
+void DebugView::RefreshHex() {
+    uint16_t first = static_cast<uint16_t>(hexScrollbar->getValue() * HEX_BYTES_PER_ROW);
+
+    for (unsigned int i = 0; i < HEX_ROWS; ++i) {
+        HexRow& row = hexRows[i];
+        uint16_t address = first + i * HEX_BYTES_PER_ROW;
+        if (address >= RAM_SIZE) {
+            if (row.valid || row.address != address) row.label->setText("");
+            row.address = address;
+            row.valid = true;
+            continue;
+        }
+
+        uint8_t bytes[HEX_BYTES_PER_ROW];
+        chip8->ReadMemory(address, bytes, HEX_BYTES_PER_ROW);
+        if (row.valid && row.address == address && memcmp(row.bytes, bytes, sizeof(bytes)) == 0) continue;
+
+        char text[16 + 3 * HEX_BYTES_PER_ROW];
+        int length = snprintf(text, sizeof(text), "%03X ", address);
+        for (uint8_t byte : bytes) length += snprintf(text + length, sizeof(text) - length, " %02X", byte);
+        row.label->setText(text);
+
+        row.address = address;
+        memcpy(row.bytes, bytes, sizeof(bytes));
+        row.valid = true;
+    }
+}
+
+
+void DebugView::RefreshCode() {
+    // Keep the PC in view, a few rows from the top, on the same instruction
+    // alignment as the PC (programs can jump to odd addresses)
+    uint16_t pc = chip8->PC() & (RAM_SIZE - 1);
+    unsigned int offset = (pc - codeStart) & (RAM_SIZE - 1);
+    if (offset % 2 != 0 || offset < 2 * 2 || offset >= 2 * (CODE_ROWS - 2)) {
+        codeStart = (pc - 2 * (CODE_ROWS / 4)) & (RAM_SIZE - 1);
+    }
+
+    const DebugPoints* points = chip8->GetDebugPoints();
+
+    for (unsigned int i = 0; i < CODE_ROWS; ++i) {
+        CodeRow& row = codeRows[i];
+        uint16_t address = (codeStart + 2 * i) & (RAM_SIZE - 1);
+        uint16_t opcode = chip8->Peek(address) << 8 | chip8->Peek((address + 1) & (RAM_SIZE - 1));
+        bool current = address == pc;
+        bool breakpoint = points && points->breakpoints[address];
+        bool data = analysis && !current && !analysis->IsCode(address) && !analysis->IsCode(address + 1) &&
+                    (analysis->flags[address] & (BYTE_SPRITE | BYTE_DATA));
+
+        if (row.valid && row.address == address && row.opcode == opcode && row.current == current &&
+            row.breakpoint == breakpoint && row.data == data) continue;
+
+        char assembly[DISASSEMBLY_LENGTH];
+        if (data) snprintf(assembly, sizeof(assembly), "DB 0x%02X, 0x%02X", opcode >> 8, opcode & 0xFF);
+        else Disassemble(opcode, chip8->GetQuirks(), assembly, sizeof(assembly));
+        char text[48];
+        snprintf(text, sizeof(text), "%c%c %03X  %04X  %s", current ? '>' : ' ', breakpoint ? '*' : ' ',
+                 address, opcode, assembly);
+        row.label->setText(text);
+        row.label->getRenderer()->setTextColor(current ? tgui::Color::Yellow : tgui::Color::White);
+
+        row.address = address;
+        row.opcode = opcode;
+        row.current = current;
+        row.breakpoint = breakpoint;
+        row.data = data;
+        row.valid = true;
+    }
+}
+
+
+// A handful of lines; formatting them is cheaper than tracking which value
+// changed, but the label is only touched when the text did
+void DebugView::RefreshRegisters() {
+    const uint8_t* V = chip8->Registers();
+    const uint16_t* stack = chip8->Stack();
+    char text[320];
+    int length = 0;
+
+    for (unsigned int r = 0; r < REGISTER_COUNT; ++r) {
+        length += snprintf(text + length, sizeof(text) - length, "V%X %02X%s", r, V[r], r % 4 == 3 ? "\n" : "   ");
+    }
+    length += snprintf(text + length, sizeof(text) - length, "\nPC %03X   I %03X\nDT %02X   ST %02X\n\nStack (%u)",
+                       chip8->PC(), chip8->Index(), chip8->DelayTimer(), chip8->SoundTimer(), chip8->SP());
+    for (unsigned int level = 0; level < chip8->SP() && level < STACK_LEVELS; ++level) {
+        length += snprintf(text + length, sizeof(text) - length, "%s%03X", level % 4 == 0 ? "\n" : " ", stack[level]);
+    }
+
+    if (registerText != text) {
+        registerText = text;
+        registerLabel->setText(registerText);
+    }
+}
+
+
+void DebugView::ToggleBreakpoint(unsigned int row) {
+    const DebugPoints* points = chip8->GetDebugPoints();
+    uint16_t address = codeRows[row].address;
+    chip8->SetBreakpoint(address, !(points && points->breakpoints[address]));
+    RefreshCode();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "chip8.h"
+#include "rom_analysis.h"
+
+#include <TGUI/TGUI.hpp>
+#include <TGUI/Backend/SFML-Graphics.hpp>
+
+// Debugger panels around the game view: a hex view of memory, the disassembly
+// around the PC and the registers.
+//
+// The panels are virtualized. There is one label per visible row, and a row
+// remembers the bytes it shows. Refresh() compares those bytes with memory
+// and formats only the rows that changed, so a 4K hex dump costs as much as
+// its 16 visible rows, and nothing at all while they stay the same.
+//
+// Clicking a disassembly row toggles a breakpoint on it (see Chip8::SetBreakpoint()).
+// With a RomAnalysis of the loaded ROM, rows the program only uses as sprites
+// or data are shown as bytes rather than as instructions.
+
+const unsigned int HEX_ROWS             = 16;
+const unsigned int HEX_BYTES_PER_ROW    = 8;
+const unsigned int CODE_ROWS            = 16;
+const unsigned int DEBUG_ROW_HEIGHT     = 18;
+const unsigned int DEBUG_VIEW_HEIGHT    = HEX_ROWS * DEBUG_ROW_HEIGHT + 20;    // Below the game view
+
+class DebugView {
+public:
+    // Add the panels to the GUI. `top` is where the strip below the game view starts.
+    void Create(tgui::Gui& gui, Chip8& machine, float top);
+
+    // The analysis of the loaded ROM, or nullptr. Kept by the caller.
+    void SetAnalysis(const RomAnalysis* romAnalysis);
+
+    // Bring the visible rows up to date with the machine
+    void Refresh();
+
+private:
+    struct HexRow {
+        tgui::Label::Ptr label;
+        uint16_t address{};
+        uint8_t bytes[HEX_BYTES_PER_ROW]{};
+        bool valid{};                       // False until formatted, or after scrolling
+    };
+
+    struct CodeRow {
+        tgui::Label::Ptr label;
+        uint16_t address{};
+        uint16_t opcode{};
+        bool current{};                     // At the PC
+        bool breakpoint{};
+        bool data{};                        // Not code according to the analysis
+        bool valid{};
+    };
+
+    Chip8* chip8{};
+    const RomAnalysis* analysis{};
+
+    HexRow hexRows[HEX_ROWS];
+    tgui::Scrollbar::Ptr hexScrollbar;      // In rows of HEX_BYTES_PER_ROW bytes
+
+    CodeRow codeRows[CODE_ROWS];
+    uint16_t codeStart{};                   // Address of the first disassembly row
+
+    tgui::Label::Ptr registerLabel;
+    std::string registerText;
+
+    void RefreshHex();
+    void RefreshCode();
+    void RefreshRegisters();
+    void ToggleBreakpoint(unsigned int row);
+};
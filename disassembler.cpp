@@ -0,0 +1,76 @@
+#include "disassembler.h"
+#include "chip8.h"
+
+#include <cstdio>
+
+size_t Disassemble(uint16_t opcode, QuirkProfile quirks, char* out, size_t size) {
+    unsigned int x = (opcode & 0x0F00) >> 8, y = (opcode & 0x00F0) >> 4;
+    unsigned int nnn = opcode & 0x0FFF, kk = opcode & 0x00FF, n = opcode & 0x000F;
+    int length;
+
+    if (!Chip8::IsValidOpcode(opcode, quirks)) {
+        length = snprintf(out, size, "DW 0x%04X", opcode);
+        return length < 0 ? 0 : static_cast<size_t>(length);
+    }
+
+    // Only valid opcodes get this far; the secondary tables are indexed the
+    // same way as in opcodes.cpp
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if (!QuirksOf(quirks).superChipOpcodes) {
+                length = snprintf(out, size, n == 0 ? "CLS" : "RET");
+                break;
+            }
+            switch (kk) {
+                case 0xFB: length = snprintf(out, size, "SCR"); break;
+                case 0xFC: length = snprintf(out, size, "SCL"); break;
+                case 0xFD: length = snprintf(out, size, "EXIT"); break;
+                case 0xFE: length = snprintf(out, size, "LOW"); break;
+                case 0xFF: length = snprintf(out, size, "HIGH"); break;
+                default:
+                    if ((kk & 0xF0) == 0xC0) length = snprintf(out, size, "SCD %u", n);
+                    else length = snprintf(out, size, n == 0 ? "CLS" : "RET");
+                    break;
+            }
+            break;
+        case 0x1000: length = snprintf(out, size, "JP 0x%03X", nnn); break;
+        case 0x2000: length = snprintf(out, size, "CALL 0x%03X", nnn); break;
+        case 0x3000: length = snprintf(out, size, "SE V%X, 0x%02X", x, kk); break;
+        case 0x4000: length = snprintf(out, size, "SNE V%X, 0x%02X", x, kk); break;
+        case 0x5000: length = snprintf(out, size, "SE V%X, V%X", x, y); break;
+        case 0x6000: length = snprintf(out, size, "LD V%X, 0x%02X", x, kk); break;
+        case 0x7000: length = snprintf(out, size, "ADD V%X, 0x%02X", x, kk); break;
+        case 0x8000: {
+            static const char* const names[0xF + 1] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                                       "", "", "", "", "", "", "SHL", ""};
+            length = snprintf(out, size, "%s V%X, V%X", names[n], x, y);
+            break;
+        }
+        case 0x9000: length = snprintf(out, size, "SNE V%X, V%X", x, y); break;
+        case 0xA000: length = snprintf(out, size, "LD I, 0x%03X", nnn); break;
+        case 0xB000:
+            // With the SUPER-CHIP quirk the jump is Bxnn: to xnn + Vx
+            if (QuirksOf(quirks).jumpUsesVx) length = snprintf(out, size, "JP V%X, 0x%03X", x, nnn);
+            else length = snprintf(out, size, "JP V0, 0x%03X", nnn);
+            break;
+        case 0xC000: length = snprintf(out, size, "RND V%X, 0x%02X", x, kk); break;
+        case 0xD000: length = snprintf(out, size, "DRW V%X, V%X, %u", x, y, n); break;
+        case 0xE000: length = snprintf(out, size, n == 0xE ? "SKP V%X" : "SKNP V%X", x); break;
+        default:
+            switch (kk) {
+                case 0x07: length = snprintf(out, size, "LD V%X, DT", x); break;
+                case 0x0A: length = snprintf(out, size, "LD V%X, K", x); break;
+                case 0x15: length = snprintf(out, size, "LD DT, V%X", x); break;
+                case 0x18: length = snprintf(out, size, "LD ST, V%X", x); break;
+                case 0x1E: length = snprintf(out, size, "ADD I, V%X", x); break;
+                case 0x29: length = snprintf(out, size, "LD F, V%X", x); break;
+                case 0x30: length = snprintf(out, size, "LD HF, V%X", x); break;
+                case 0x33: length = snprintf(out, size, "LD B, V%X", x); break;
+                case 0x55: length = snprintf(out, size, "LD [I], V%X", x); break;
+                case 0x75: length = snprintf(out, size, "LD R, V%X", x); break;
+                case 0x85: length = snprintf(out, size, "LD V%X, R", x); break;
+                default:   length = snprintf(out, size, "LD V%X, [I]", x); break;
+            }
+    }
+    return length < 0 ? 0 : static_cast<size_t>(length);
+}
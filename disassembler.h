@@ -0,0 +1,16 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Cowgod-style assembly for one opcode ("LD V3, 0x1F", "DRW V0, V1, 5").
+// Opcodes are decoded the way the core's dispatch tables decode them, so the
+// text says what a machine in the `quirks` profile will actually do; opcodes
+// it does not execute come out as "DW 0xNNNN". Writes at most `size` bytes including the
+// terminating zero and returns the length, like snprintf.
+size_t Disassemble(uint16_t opcode, QuirkProfile quirks, char* out, size_t size);
+
+// Longest text Disassemble() produces, plus the terminating zero
+const size_t DISASSEMBLY_LENGTH = 24;
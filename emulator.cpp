@@ -1,15 +1,30 @@
 #include "emulator.h"
 
-Emulator::Emulator()
-        : chip8(), window(sf::VideoMode(DISPLAY_WIDTH * 15, DISPLAY_HEIGHT * 10), "CHIP-8") {
-    chip8.LoadROM("../roms/Chip8 emulator Logo [Garstyciuks].ch8");
+#include <filesystem>
+
+Emulator::Emulator(const std::string& romSource)
+        : chip8(), timeTravel(chip8), window(sf::VideoMode(LORES_WIDTH * 15, LORES_HEIGHT * 10 + DEBUG_VIEW_HEIGHT), "CHIP-8"),
+          romDirectory(romSource), romCatalog(romSource) {
+    // An archive is mapped and its index is ready immediately. For a directory,
+    // start scanning right away; the selector is filled in from Run() once the
+    // scan is done, so a large collection never blocks startup.
+    if (std::filesystem::is_directory(romSource) || !romArchive.Open(romSource)) romCatalog.ScanAsync();
+
+    LoadGame(STARTUP_ROM);
     SetupGUI();
 }
 
 void Emulator::Run() {
     while (window.isOpen()) {
         HandleInput();
-        chip8.Cycle();
+        if (!paused) Execute();
+
+        if (!romSelectorFilled && (romArchive.IsOpen() || romCatalog.Ready())) FillRomSelector();
+
+        if (debugClock.getElapsedTime() >= sf::milliseconds(16)) {
+            debugView.Refresh();
+            debugClock.restart();
+        }
 
         if (chip8.drawFlag) Render();
 
@@ -29,53 +44,115 @@ void Emulator::SetupGUI() {
     // Set the number of items to display before scrollbar is needed
     romSelector->setItemsToDisplay(9);
 
-    // Populate the ComboBox with the names of available ROMs
+    // The names of the available ROMs are added by FillRomSelector()
     romSelector->addItem("PLEASE SELECT A GAME");
-    romSelector->addItem("15PUZZLE");
-    romSelector->addItem("BLINKY");
-    romSelector->addItem("BLITZ");
-    romSelector->addItem("BRIX");
-    romSelector->addItem("CONNECT4");
-    romSelector->addItem("GUESS");
-    romSelector->addItem("HIDDEN");
-    romSelector->addItem("INVADERS");
-    romSelector->addItem("KALEID");
-    romSelector->addItem("MAZE");
-    romSelector->addItem("MERLIN");
-    romSelector->addItem("MISSILE");
-    romSelector->addItem("PONG");
-    romSelector->addItem("PONG2");
-    romSelector->addItem("PUZZLE");
-    romSelector->addItem("SYZYGY");
-    romSelector->addItem("TANK");
-    romSelector->addItem("TETRIS");
-    romSelector->addItem("TICTAC");
-    romSelector->addItem("UFO");
-    romSelector->addItem("VBRIX");
-    romSelector->addItem("VERS");
-    romSelector->addItem("WIPEOFF");
 
     // Setup the onItemSelect callback
     romSelector->onItemSelect([this](const tgui::String& item) {
         if (item.toStdString() == "PLEASE SELECT A GAME") return;
-        std::string romPath = "../roms/" + item.toStdString();
-        chip8.LoadROM(romPath);
+
+        if (!LoadGame(item.toStdString())) return;
 
         // Set the window title to the name of the ROM
         window.setTitle(item.toStdString());
     });
 
     gui.add(romSelector);
+
+    debugView.Create(gui, chip8, LORES_HEIGHT * 10);
+}
+
+// Populate the ComboBox with the ROMs in the archive, or with the ROMs found
+// by the catalog scan and start loading them into the ROM cache in the background.
+void Emulator::FillRomSelector() {
+    if (romArchive.IsOpen()) {
+        for (size_t i = 0; i < romArchive.Count(); ++i) romSelector->addItem(std::string(romArchive.At(i).name));
+        romSelectorFilled = true;
+        return;
+    }
+
+    std::vector<std::string> names;
+    for (const RomInfo& info : romCatalog.Entries()) {
+        if (info.variant == "too large") continue;
+        romSelector->addItem(info.name);
+        names.push_back(info.name);
+    }
+    romCache.PreloadAsync(romDirectory, std::move(names));
+    romSelectorFilled = true;
+}
+
+// Load a ROM by name, straight from the archive mapping when there is one,
+// otherwise from the ROM cache (normally already preloaded by FillRomSelector()).
+bool Emulator::LoadGame(const std::string& name) {
+    faultReported = false;
+    paused = false;
+
+    bool loaded;
+    if (romArchive.IsOpen()) {
+        ArchivedRom rom{};
+        loaded = romArchive.Find(name, rom) && chip8.LoadROM(rom.data, rom.size);
+        if (loaded) romAnalysis = AnalyzeRom(rom.data, rom.size, chip8.GetQuirks());
+    } else {
+        auto image = romCache.Get(romDirectory, name);
+        loaded = image && chip8.LoadROM(image->bytes.data(), image->bytes.size());
+        if (loaded) romAnalysis = AnalyzeRom(image->bytes.data(), image->bytes.size(), chip8.GetQuirks());
+    }
+
+    // The history starts with the game
+    if (loaded) {
+        timeTravel.Start();
+        debugView.SetAnalysis(&romAnalysis);
+    }
+    return loaded;
+}
+
+// The game has stopped: say why and leave a trace of how it got there. The
+// recent instructions go to stderr and a Chrome trace_event file is written to
+// the working directory. Another game can still be picked from the selector.
+void Emulator::ReportFault() {
+    std::cout << "Stopped (" << FaultName(chip8.LastFault()) << "): " << std::hex << std::uppercase
+              << chip8.CurrentOpcode() << " at 0x" << chip8.PC() << std::dec << std::endl;
+
+    chip8.DumpTrace(std::cerr);
+
+    std::ofstream traceFile("chip8_trace.json");
+    chip8.DumpTraceJSON(traceFile);
+
+    window.setTitle("CHIP-8 - stopped: " + std::string(FaultName(chip8.LastFault())));
+    faultReported = true;
+}
+
+// Run one instruction. A breakpoint or watchpoint pauses the emulator on the
+// instruction it stopped at; resuming (P, or Right to step) then executes it.
+void Emulator::Execute() {
+    Fault fault = timeTravel.Step();
+    if (IsDebugStop(fault)) {
+        chip8.Resume();
+        paused = true;
+        ShowPosition();
+    } else if (fault != Fault::None && !faultReported) {
+        ReportFault();
+    }
+}
+
+// While paused, the window title says where in the program we are
+void Emulator::ShowPosition() {
+    char title[96];
+    snprintf(title, sizeof(title), "CHIP-8 - paused at instruction %llu (pc 0x%03X)",
+             static_cast<unsigned long long>(timeTravel.Cycle()), chip8.PC());
+    window.setTitle(title);
 }
 
 void Emulator::Render() {
     window.clear(sf::Color::Black);
 
-    float pixelSize = 10.0; // Define the size of a pixel on the window
+    // Define the size of a pixel on the window; hires pixels are half the size,
+    // so the screen covers the same area in either mode
+    float pixelSize = chip8.HiRes() ? 5.0 : 10.0;
 
-    for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-        for (int x = 0; x < DISPLAY_WIDTH; ++x) {
-            if (chip8.display[y * DISPLAY_WIDTH + x]) {
+    for (unsigned int y = 0; y < chip8.DisplayHeight(); ++y) {
+        for (unsigned int x = 0; x < chip8.DisplayWidth(); ++x) {
+            if (chip8.Pixel(x, y)) {
                 sf::RectangleShape pixel(sf::Vector2f(pixelSize, pixelSize));
                 pixel.setPosition(x * pixelSize, y * pixelSize);
                 pixel.setFillColor(sf::Color::White);
@@ -127,6 +204,28 @@ void Emulator::HandleInput() {
                     case sf::Keyboard::C: chip8.key[0xB] = 1; break;
                     case sf::Keyboard::V: chip8.key[0xF] = 1; break;
 
+                    // Debugger: pause, then step forward or backward one instruction
+                    // at a time. Stepping back from a fault undoes it.
+                    case sf::Keyboard::P:
+                        paused = !paused;
+                        if (paused) ShowPosition();
+                        else window.setTitle("CHIP-8");
+                        break;
+                    case sf::Keyboard::Right:
+                        if (!paused) break;
+                        Execute();
+                        ShowPosition();
+                        debugView.Refresh();
+                        break;
+                    case sf::Keyboard::Left:
+                        if (!paused && !faultReported) break;
+                        paused = true;
+                        timeTravel.StepBack();
+                        faultReported = false;
+                        ShowPosition();
+                        debugView.Refresh();
+                        break;
+
                     default: break;
                 }
                 break;
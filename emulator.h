@@ -1,6 +1,12 @@
 #pragma once
 
 #include "chip8.h"
+#include "debug_view.h"
+#include "rom_archive.h"
+#include "rom_cache.h"
+#include "rom_analysis.h"
+#include "rom_catalog.h"
+#include "time_travel.h"
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
@@ -13,21 +19,42 @@
 #include <TGUI/Widgets/Button.hpp>
 #include <TGUI/Widgets/CheckBox.hpp>
 
+// Where the frontend looks for ROMs by default, relative to the working directory (the build tree).
+const char* const ROM_DIRECTORY = "../roms";
+const char* const STARTUP_ROM = "Chip8 emulator Logo [Garstyciuks].ch8";
+
 class Emulator {
 public:
-    Emulator();
+    explicit Emulator(const std::string& romSource);
     void Run();
 
 private:
     Chip8 chip8;
+    TimeTravel timeTravel;            // Records every instruction so the debugger can step backwards
+    bool paused{};                    // P pauses; then Right/Left step one instruction forward/back
+    RomAnalysis romAnalysis;          // Of the loaded ROM; a few microseconds per load
+    DebugView debugView;              // Memory, disassembly and registers below and beside the game
+    sf::Clock debugClock;             // The debug view is refreshed at most at 60Hz
 
     void SetupGUI();
+    void FillRomSelector();
+    bool LoadGame(const std::string& name);
+    void Execute();
+    void ReportFault();
+    void ShowPosition();
     void Render();
     void HandleInput();
 
     sf::RenderWindow window;
     tgui::Gui gui;
     tgui::ComboBox::Ptr romSelector;  // The dropdown menu (ComboBox) for ROM selection
+    bool faultReported{};             // The current game has stopped and ReportFault() has run
+
+    std::string romDirectory;         // Used when the ROM source is a directory
+    RomArchive romArchive;            // Open when the ROM source is a .c8pk archive
+    RomCatalog romCatalog;            // Scans romDirectory in the background
+    bool romSelectorFilled{};         // Set once the catalog scan has been copied into romSelector
+    RomCache romCache;                // Preloaded ROM images, so switching games does no file I/O
 };
 
 
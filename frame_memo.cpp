@@ -0,0 +1,142 @@
+#include "frame_memo.h"
+
+#include <bit>
+#include <cstring>
+
+// Multiply-xorshift over 8-byte words in four independent lanes, so that the
+// multiplies overlap; several times faster than Fnv1a() on a page. size must
+// be a multiple of 32.
+static uint64_t HashBlock(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t lanes[4] = {seed, seed ^ 1, seed ^ 2, seed ^ 3};
+
+    for (size_t offset = 0; offset < size; offset += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            memcpy(&word, data + offset + 8 * lane, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * K;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    uint64_t hash = size;
+    for (uint64_t lane : lanes) hash = std::rotl(hash ^ lane, 23) * K;
+    return hash ^ (hash >> 32);
+}
+
+
+FrameMemo::FrameMemo(size_t capacity) : capacity(capacity) {
+    frames.reserve(capacity);
+}
+
+
+void FrameMemo::Clear() {
+    frames.clear();
+    machine = nullptr;
+}
+
+
+// The page and display hashes are brought up to date from what the machine
+// wrote since the last call; the rest of the state is small enough to hash
+// every time.
+uint64_t FrameMemo::StateHash(Chip8& chip8, uint32_t cycles) {
+    if (machine != &chip8) {
+        machine = &chip8;
+        chip8.writtenPages = (1u << MEMORY_PAGE_COUNT) - 1;
+        displayWrites = chip8.displayWrites - 1;
+    }
+
+    for (uint16_t written = chip8.writtenPages; written != 0; written &= written - 1) {
+        unsigned int page = std::countr_zero(written);
+        pageHashes[page] = HashBlock(chip8.pages[page]->bytes, MEMORY_PAGE_SIZE, page);
+    }
+    chip8.writtenPages = 0;
+
+    if (displayWrites != chip8.displayWrites) {
+        displayWrites = chip8.displayWrites;
+        displayHash = HashBlock(reinterpret_cast<const uint8_t*>(chip8.display), sizeof(chip8.display), MEMORY_PAGE_COUNT);
+    }
+
+    struct {
+        uint8_t V[REGISTER_COUNT];
+        uint8_t key[KEY_COUNT];
+        uint16_t stack[STACK_LEVELS];
+        uint16_t pc, I, sp;
+        uint8_t delayTimer, soundTimer;
+        uint32_t randomSeed, randomDraws, cycles;
+        uint8_t fault, quirks, hires;
+        uint8_t rplFlags[RPL_FLAG_COUNT];
+        uint8_t padding[25];
+    } registers{};
+    static_assert(sizeof(registers) % 32 == 0, "HashBlock() takes whole 32-byte blocks");
+
+    memcpy(registers.V, chip8.V, sizeof(registers.V));
+    memcpy(registers.key, chip8.key, sizeof(registers.key));
+    memcpy(registers.stack, chip8.stack, sizeof(registers.stack));
+    registers.pc = chip8.pc;
+    registers.I = chip8.I;
+    registers.sp = chip8.sp;
+    registers.delayTimer = chip8.delayTimer;
+    registers.soundTimer = chip8.soundTimer;
+    registers.randomSeed = chip8.randomSeed;
+    registers.randomDraws = chip8.randomDraws;
+    registers.cycles = cycles;
+    registers.fault = static_cast<uint8_t>(chip8.fault);
+    registers.quirks = static_cast<uint8_t>(chip8.quirks);
+    registers.hires = chip8.hires;
+    memcpy(registers.rplFlags, chip8.rplFlags, sizeof(registers.rplFlags));
+
+    uint64_t hash = HashBlock(reinterpret_cast<const uint8_t*>(&registers), sizeof(registers), displayHash);
+    for (uint64_t pageHash : pageHashes) hash = std::rotl(hash, 27) ^ pageHash;
+    return hash * 0x9E3779B97F4A7C15ull;
+}
+
+
+Fault FrameMemo::RunFrame(Chip8& chip8, uint32_t cycles, uint32_t* executed) {
+    // The machine keeps track of what it writes in the meantime, so skipping
+    // frames costs the hash nothing
+    if (++sinceHit > MEMO_SPARSE_AFTER && sinceHit % MEMO_SPARSE_INTERVAL != 0) {
+        ++misses;
+        uint32_t count;
+        Fault fault = chip8.RunCycles(cycles, &count);
+        if (executed) *executed = count;
+        return fault;
+    }
+
+    uint64_t before = StateHash(chip8, cycles);
+
+    auto found = frames.find(before);
+    if (found != frames.end()) {
+        const Frame& frame = found->second;
+        chip8.LoadState(frame.after);
+
+        // The hashes of the loaded state were stored with it
+        chip8.writtenPages = 0;
+        memcpy(pageHashes, frame.pageHashes, sizeof(pageHashes));
+        displayHash = frame.displayHash;
+        displayWrites = chip8.displayWrites;
+
+        ++hits;
+        sinceHit = 0;
+        if (executed) *executed = frame.executed;
+        return chip8.fault;
+    }
+
+    ++misses;
+    uint32_t count;
+    Fault fault = chip8.RunCycles(cycles, &count);
+    if (executed) *executed = count;
+    if (fault != Fault::None) return fault;
+
+    if (frames.size() >= capacity) frames.clear();
+
+    Frame& frame = frames[before];
+    frame.after = chip8.SaveState();
+    frame.executed = count;
+
+    // Hashing the new state now is work the next frame would do anyway
+    StateHash(chip8, cycles);
+    memcpy(frame.pageHashes, pageHashes, sizeof(pageHashes));
+    frame.displayHash = displayHash;
+    return fault;
+}
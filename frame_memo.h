@@ -0,0 +1,70 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <unordered_map>
+
+// Frame memoization for programs that go round in circles: attract modes,
+// demos, a title screen waiting for a key. At every frame boundary the whole
+// machine state (memory, registers, stack, timers, RNG, display and the keys
+// held) is hashed; if the same state was seen before, the frame is not run
+// but the state it led to is loaded instead, framebuffer included. A run of
+// frames seen before replays as a run of loads.
+//
+// The hash is kept up to date incrementally: only the memory pages written
+// since the last frame, and the display if anything was drawn, are hashed
+// again. States are compared by their 64-bit hash alone.
+//
+// Storing a frame costs more than running it, so after MEMO_SPARSE_AFTER frames
+// without a hit (a game being played, say) only every MEMO_SPARSE_INTERVAL-th
+// frame is looked up and stored, and the others run at full speed. The first
+// hit goes back to every frame. A cycle through states then costs at most
+// MEMO_SPARSE_INTERVAL passes to pick up again.
+//
+//   FrameMemo memo;
+//   while (...) { ApplyKeys(chip8, keys); memo.RunFrame(chip8, CYCLES_PER_FRAME); }
+//
+// Replayed frames leave nothing in the instruction trace.
+
+const size_t DEFAULT_MEMO_CAPACITY     = 4096;
+const uint32_t MEMO_SPARSE_AFTER        = 64;
+const uint32_t MEMO_SPARSE_INTERVAL     = 32;
+
+
+class FrameMemo {
+public:
+    // Once `capacity` frames are stored the memo starts over
+    explicit FrameMemo(size_t capacity = DEFAULT_MEMO_CAPACITY);
+
+    // Run (or replay) one frame of `cycles` instructions on `chip8`. `executed`
+    // receives the number of instructions the frame took, replayed or not.
+    // Frames that end in a fault are never stored.
+    Fault RunFrame(Chip8& chip8, uint32_t cycles, uint32_t* executed = nullptr);
+
+    void Clear();
+
+    [[nodiscard]] uint64_t Hits() const { return hits; }
+    [[nodiscard]] uint64_t Misses() const { return misses; }        // Frames run, whether stored or not
+    [[nodiscard]] size_t Size() const { return frames.size(); }
+
+private:
+    struct Frame {
+        MachineState after;
+        uint64_t pageHashes[MEMORY_PAGE_COUNT];
+        uint64_t displayHash;
+        uint32_t executed;
+    };
+
+    size_t capacity;
+    std::unordered_map<uint64_t, Frame> frames;     // By the hash of the state before the frame
+    uint64_t hits{}, misses{};
+    uint32_t sinceHit{};                            // Frames run since the last hit
+
+    // Hashes of the machine as it was when last seen
+    const Chip8* machine{};
+    uint64_t pageHashes[MEMORY_PAGE_COUNT]{};
+    uint64_t displayHash{};
+    uint32_t displayWrites{};
+
+    uint64_t StateHash(Chip8& chip8, uint32_t cycles);
+};
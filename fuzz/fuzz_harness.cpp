@@ -0,0 +1,71 @@
+#include "fuzz_harness.h"
+
+#include <algorithm>
+
+// Knuth's multiplicative hash of the 28-bit (pc, opcode) pair
+static uint32_t EdgeIndex(uint16_t pc, uint16_t opcode) {
+    return ((static_cast<uint32_t>(pc) << 16 | opcode) * 0x9E3779B1u) >> 16;
+}
+
+
+FuzzHarness::FuzzHarness(uint8_t* coverage, uint32_t maxCycles)
+    : coverage(coverage), maxCycles(maxCycles) {}
+
+
+bool FuzzHarness::SetFixedRom(const uint8_t* rom, size_t size) {
+    fixedRom = chip8.LoadROM(rom, size);
+    return fixedRom;
+}
+
+
+FuzzResult FuzzHarness::Execute(const uint8_t* data, size_t size) {
+    const uint8_t* eventData = data;
+    size_t eventCount = size / 3;
+    if (!fixedRom) {
+        eventData = data + (size > 0 ? 1 : 0);
+        eventCount = size > 0 ? std::min<size_t>(data[0], (size - 1) / 3) : 0;
+    }
+
+    events.clear();
+    for (size_t i = 0; i < eventCount; ++i) {
+        const uint8_t* event = eventData + 3 * i;
+        events.push_back({event[0], static_cast<uint16_t>(event[1] | event[2] << 8)});
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+
+    if (fixedRom) {
+        // Only the pages the last run wrote get copied back
+        chip8.Reset();
+    } else {
+        const uint8_t* rom = eventData + 3 * eventCount;
+        size_t romSize = std::min<size_t>(data + size - rom, MAX_ROM_SIZE);
+        chip8.LoadROM(rom, romSize);
+    }
+    chip8.Seed(0);
+
+    FuzzResult result;
+    size_t nextEvent = 0;
+
+    for (uint32_t frame = 0; result.cycles < maxCycles; ++frame) {
+        while (nextEvent < events.size() && events[nextEvent].frame <= frame) ++nextEvent;
+        ApplyKeys(chip8, nextEvent > 0 ? events[nextEvent - 1].keys : 0);
+
+        for (uint32_t i = 0; i < CYCLES_PER_FRAME && result.cycles < maxCycles; ++i) {
+            result.pc = chip8.PC();
+            result.opcode = chip8.Peek(result.pc) << 8 | chip8.Peek(result.pc + 1);
+
+            uint8_t& counter = coverage[EdgeIndex(result.pc, result.opcode)];
+            if (counter != 0xFF) ++counter;
+
+            // A jump to itself is how most programs halt
+            if (result.opcode == (0x1000 | result.pc)) return result;
+
+            result.fault = chip8.Cycle();
+            if (result.fault != Fault::None) return result;
+            ++result.cycles;
+        }
+    }
+    return result;
+}
+
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "chip8.h"
+#include "headless.h"
+
+#include <vector>
+
+// Shared by the libFuzzer target (fuzz/libfuzzer_target.cpp) and the
+// standalone loop (fuzz/fuzz_loop.cpp).
+//
+// An input is a list of key events followed by a ROM:
+//
+//   byte 0     number of key events k
+//   k * 3      frame (1 byte), key mask (2 bytes, little-endian)
+//   rest       ROM image (at most MAX_ROM_SIZE bytes; anything beyond is ignored)
+//
+// With a fixed ROM (SetFixedRom()) the whole input is key events, 3 bytes each,
+// so that only the input sequence is fuzzed.
+
+const unsigned int COVERAGE_MAP_SIZE    = 1 << 16;
+const unsigned int DEFAULT_FUZZ_CYCLES  = 4096;
+
+// A crash is any fault other than an invalid opcode, i.e. an access the core
+// refused to make because it would have gone out of bounds (see Chip8::Fault).
+// Running into an invalid opcode just ends the run.
+[[nodiscard]] inline bool IsCrash(Fault fault) {
+    return fault != Fault::None && fault != Fault::InvalidOpcode && !IsDebugStop(fault);
+}
+
+struct FuzzResult {
+    Fault fault{Fault::None};
+    uint16_t pc{};          // Of the last instruction, or of the faulting one
+    uint16_t opcode{};
+    uint64_t cycles{};      // Instructions executed
+};
+
+
+class FuzzHarness {
+public:
+    // `coverage` points to COVERAGE_MAP_SIZE saturating counters, one per
+    // hashed (pc, opcode) edge; the caller owns (and clears) them.
+    FuzzHarness(uint8_t* coverage, uint32_t maxCycles);
+
+    bool SetFixedRom(const uint8_t* rom, size_t size);
+
+    FuzzResult Execute(const uint8_t* data, size_t size);
+
+    // The machine as the last Execute() left it (e.g. for its trace)
+    [[nodiscard]] const Chip8& Machine() const { return chip8; }
+
+private:
+    Chip8 chip8;
+    uint8_t* coverage;
+    uint32_t maxCycles;
+    bool fixedRom{};
+
+    std::vector<InputEvent> events;         // Parsed from the current input, sorted by frame
+};
@@ -0,0 +1,288 @@
+// Standalone coverage-guided fuzzer; needs no compiler support, unlike the
+// libFuzzer target.
+//
+//   FuzzLoop [--rom FILE] [--seeds DIR] [--out DIR] [--seconds S] [--runs N]
+//            [--cycles N] [--max-len N] [--seed N]
+//   FuzzLoop [--rom FILE] --replay INPUT
+//
+// Without --rom, inputs are ROMs (seeded from --seeds, default ../roms) plus a
+// key sequence; with --rom, only the key sequence of that ROM is fuzzed (see
+// fuzz_harness.h for the input format). Inputs that reach a new (pc, opcode)
+// edge, or an edge a new number of times, are kept in the corpus. Each distinct
+// crash (kind and pc) is written to --out (default fuzz-out) and can be rerun
+// with --replay, which also prints the trace of the last instructions.
+
+#include "fuzz_harness.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <random>
+#include <set>
+
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+
+// AFL-style hit count classes, so that a loop running a different number of
+// times counts as new behaviour without every extra iteration doing so.
+static uint8_t Bucket(uint8_t hits) {
+    if (hits <= 3) return hits == 0 ? 0 : 1 << (hits - 1);
+    if (hits < 8) return 1 << 3;
+    if (hits < 16) return 1 << 4;
+    if (hits < 32) return 1 << 5;
+    if (hits < 128) return 1 << 6;
+    return 1 << 7;
+}
+
+
+class FuzzLoop {
+public:
+    FuzzLoop(uint32_t cycles, size_t maxLength, uint64_t seed, bool fixedRom)
+        : harness(counters, cycles), maxLength(maxLength), rng(seed), fixedRom(fixedRom) {}
+
+    FuzzHarness harness;
+
+    void AddSeed(std::vector<uint8_t> input) {
+        if (input.size() > maxLength) input.resize(maxLength);
+        Run(input);
+        corpus.push_back(std::move(input));
+    }
+
+    void Fuzz(double seconds, uint64_t runs, const std::filesystem::path& outDirectory);
+
+private:
+    uint8_t counters[COVERAGE_MAP_SIZE]{};
+    uint8_t seen[COVERAGE_MAP_SIZE]{};      // Union of the buckets hit so far, per edge
+
+    size_t maxLength;
+    std::mt19937_64 rng;
+    bool fixedRom;
+
+    std::vector<std::vector<uint8_t>> corpus;
+    std::set<std::pair<Fault, uint16_t>> crashes;
+    uint64_t executions{};
+    size_t edges{};
+    FuzzResult lastResult;
+
+    bool Run(const std::vector<uint8_t>& input);
+    void Mutate(std::vector<uint8_t>& input);
+    size_t Random(size_t bound) { return bound == 0 ? 0 : rng() % bound; }
+};
+
+
+// Execute one input and fold its coverage into `seen`. Returns true if it did
+// something new. The counters are cleared on the way.
+bool FuzzLoop::Run(const std::vector<uint8_t>& input) {
+    lastResult = harness.Execute(input.data(), input.size());
+    ++executions;
+
+    bool interesting = false;
+    auto* words = reinterpret_cast<uint64_t*>(counters);
+    for (size_t w = 0; w < COVERAGE_MAP_SIZE / 8; ++w) {
+        if (words[w] == 0) continue;    // Most of the map is untouched by any one run
+        for (size_t i = w * 8; i < w * 8 + 8; ++i) {
+            uint8_t bucket = Bucket(counters[i]);
+            if (bucket & ~seen[i]) {
+                if (seen[i] == 0) ++edges;
+                seen[i] |= bucket;
+                interesting = true;
+            }
+        }
+        words[w] = 0;
+    }
+    return interesting;
+}
+
+
+void FuzzLoop::Mutate(std::vector<uint8_t>& input) {
+    // The ROM part starts after the key events; mutations that write whole
+    // opcodes keep them aligned to it.
+    size_t romStart = fixedRom || input.empty() ? 0 : 1 + 3 * std::min<size_t>(input[0], (input.size() - 1) / 3);
+
+    int stacked = 1 + static_cast<int>(Random(4));
+    for (int m = 0; m < stacked; ++m) {
+        if (input.empty()) input.push_back(0);
+
+        switch (Random(8)) {
+            case 0:     // Flip a bit
+                input[Random(input.size())] ^= 1 << Random(8);
+                break;
+            case 1:     // Random byte
+                input[Random(input.size())] = static_cast<uint8_t>(rng());
+                break;
+            case 2: {   // Random instruction at an instruction boundary
+                if (fixedRom || input.size() < romStart + 2) break;
+                size_t offset = romStart + 2 * Random((input.size() - romStart) / 2);
+                uint16_t opcode = static_cast<uint16_t>(rng());
+                input[offset] = opcode >> 8;
+                input[offset + 1] = opcode & 0xFF;
+                break;
+            }
+            case 3: {   // Insert random bytes
+                size_t count = 1 + Random(fixedRom ? 6 : 8);
+                if (input.size() + count > maxLength) break;
+                std::vector<uint8_t> bytes(count);
+                for (uint8_t& b : bytes) b = static_cast<uint8_t>(rng());
+                input.insert(input.begin() + static_cast<std::ptrdiff_t>(Random(input.size() + 1)), bytes.begin(), bytes.end());
+                break;
+            }
+            case 4: {   // Erase a few bytes
+                size_t offset = Random(input.size());
+                size_t count = std::min(1 + Random(8), input.size() - offset);
+                input.erase(input.begin() + static_cast<std::ptrdiff_t>(offset),
+                            input.begin() + static_cast<std::ptrdiff_t>(offset + count));
+                break;
+            }
+            case 5: {   // Copy a chunk of the input over another part of it
+                size_t count = 1 + Random(std::min<size_t>(input.size(), 32));
+                size_t from = Random(input.size() - count + 1), to = Random(input.size() - count + 1);
+                std::memmove(input.data() + to, input.data() + from, count);
+                break;
+            }
+            case 6: {   // Splice in the tail of another corpus entry
+                const std::vector<uint8_t>& other = corpus[Random(corpus.size())];
+                if (other.empty()) break;
+                size_t cut = Random(input.size()), otherCut = Random(other.size());
+                input.resize(cut);
+                input.insert(input.end(), other.begin() + static_cast<std::ptrdiff_t>(otherCut), other.end());
+                if (input.size() > maxLength) input.resize(maxLength);
+                break;
+            }
+            default:    // Change the number of key events
+                if (!fixedRom) input[0] = static_cast<uint8_t>(Random(16));
+                break;
+        }
+    }
+}
+
+
+void FuzzLoop::Fuzz(double seconds, uint64_t runs, const std::filesystem::path& outDirectory) {
+    std::filesystem::create_directories(outDirectory);
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    uint64_t startExecutions = executions;
+
+    for (uint64_t run = 0; runs == 0 || run < runs; ++run) {
+        std::vector<uint8_t> input = corpus[Random(corpus.size())];
+        Mutate(input);
+
+        bool interesting = Run(input);
+        if (IsCrash(lastResult.fault)) {
+            if (crashes.insert({lastResult.fault, lastResult.pc}).second) {
+                char name[64];
+                snprintf(name, sizeof(name), "crash-%d-%03X.bin", static_cast<int>(lastResult.fault), lastResult.pc);
+                std::ofstream(outDirectory / name, std::ios::binary)
+                        .write(reinterpret_cast<const char*>(input.data()), static_cast<std::streamsize>(input.size()));
+
+                char line[128];
+                snprintf(line, sizeof(line), "%s: %04X at 0x%03X -> %s", FaultName(lastResult.fault),
+                         lastResult.opcode, lastResult.pc, name);
+                std::cerr << line << std::endl;
+            }
+        } else if (interesting) {
+            corpus.push_back(std::move(input));
+        }
+
+        // Checking the clock on every run would cost more than a short run
+        if ((run & 0x3FF) == 0) {
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - start).count();
+            bool done = seconds > 0 && elapsed >= seconds;
+
+            if (done || now - lastReport >= std::chrono::seconds(1)) {
+                lastReport = now;
+                char line[160];
+                snprintf(line, sizeof(line), "#%llu  %.0f exec/s  corpus %zu  edges %zu  crashes %zu",
+                         static_cast<unsigned long long>(executions),
+                         static_cast<double>(executions - startExecutions) / elapsed, corpus.size(), edges,
+                         crashes.size());
+                std::cerr << line << std::endl;
+            }
+            if (done) break;
+        }
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string romPath, seedDirectory, replayPath;
+    std::string outDirectory = "fuzz-out";
+    double seconds = 60;
+    uint64_t runs = 0;
+    uint32_t cycles = DEFAULT_FUZZ_CYCLES;
+    size_t maxLength = 1024;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rom" && hasValue) romPath = argv[++i];
+        else if (arg == "--seeds" && hasValue) seedDirectory = argv[++i];
+        else if (arg == "--out" && hasValue) outDirectory = argv[++i];
+        else if (arg == "--seconds" && hasValue) seconds = std::stod(argv[++i]);
+        else if (arg == "--runs" && hasValue) runs = std::stoull(argv[++i]);
+        else if (arg == "--cycles" && hasValue) cycles = std::stoul(argv[++i]);
+        else if (arg == "--max-len" && hasValue) maxLength = std::stoul(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = std::stoull(argv[++i]);
+        else if (arg == "--replay" && hasValue) replayPath = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--rom FILE] [--seeds DIR] [--out DIR] [--seconds S] [--runs N]\n"
+                      << "       [--cycles N] [--max-len N] [--seed N]\n"
+                      << "       " << argv[0] << " [--rom FILE] --replay INPUT" << std::endl;
+            return 2;
+        }
+    }
+
+    FuzzLoop loop(cycles, maxLength, seed, !romPath.empty());
+    if (!romPath.empty()) {
+        std::vector<uint8_t> rom = ReadFile(romPath);
+        if (!loop.harness.SetFixedRom(rom.data(), rom.size())) {
+            std::cerr << "Cannot load ROM " << romPath << std::endl;
+            return 2;
+        }
+    }
+
+    if (!replayPath.empty()) {
+        std::vector<uint8_t> input = ReadFile(replayPath);
+        FuzzResult result = loop.harness.Execute(input.data(), input.size());
+        loop.harness.Machine().DumpTrace(std::cout);
+
+        char line[128];
+        snprintf(line, sizeof(line), "%s: %04X at 0x%03X after %llu instructions", FaultName(result.fault),
+                 result.opcode, result.pc, static_cast<unsigned long long>(result.cycles));
+        std::cout << line << std::endl;
+        return IsCrash(result.fault) ? 1 : 0;
+    }
+
+    if (romPath.empty()) {
+        // Every ROM found is a seed, with no key events
+        if (seedDirectory.empty()) seedDirectory = "../roms";
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(seedDirectory, error)) {
+            if (!entry.is_regular_file() || entry.path().filename().string()[0] == '.') continue;
+            std::vector<uint8_t> input = ReadFile(entry.path());
+            input.insert(input.begin(), 0);
+            loop.AddSeed(std::move(input));
+        }
+        loop.AddSeed({0});
+    } else {
+        // No input, and a walk over the keypad like InputScript::Default()
+        loop.AddSeed({});
+        std::vector<uint8_t> walk;
+        for (int k = 0; k < 16; ++k) {
+            uint16_t keys = 1 << k;
+            walk.insert(walk.end(), {static_cast<uint8_t>(15 * k), static_cast<uint8_t>(keys & 0xFF),
+                                     static_cast<uint8_t>(keys >> 8)});
+        }
+        loop.AddSeed(std::move(walk));
+    }
+
+    loop.Fuzz(seconds, runs, outDirectory);
+    return 0;
+}
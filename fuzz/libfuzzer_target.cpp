@@ -0,0 +1,46 @@
+// libFuzzer entry point (built with Clang only; see CMakeLists.txt).
+//
+//   ./Chip8Fuzzer corpus/                        Fuzz ROMs (and the input that drives them)
+//   CHIP8_FUZZ_ROM=game.ch8 ./Chip8Fuzzer corpus/  Fuzz the key input of one ROM
+//
+// Besides the code coverage of the harness itself, libFuzzer picks up the
+// (pc, opcode) edge counters through its "extra counters" section.
+
+#include "fuzz_harness.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#if defined(__linux__)
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t edgeCounters[COVERAGE_MAP_SIZE];
+
+static FuzzHarness harness(edgeCounters, DEFAULT_FUZZ_CYCLES);
+
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    if (const char* romPath = std::getenv("CHIP8_FUZZ_ROM")) {
+        std::ifstream file(romPath, std::ios::binary);
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.is_open() || !harness.SetFixedRom(rom.data(), rom.size())) {
+            std::cerr << "Cannot load CHIP8_FUZZ_ROM " << romPath << std::endl;
+            std::exit(1);
+        }
+    }
+    return 0;
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    FuzzResult result = harness.Execute(data, size);
+    if (IsCrash(result.fault)) {
+        char line[96];
+        snprintf(line, sizeof(line), "%s: %04X at 0x%03X after %llu instructions", FaultName(result.fault),
+                 result.opcode, result.pc, static_cast<unsigned long long>(result.cycles));
+        std::cerr << line << std::endl;
+        std::abort();
+    }
+    return 0;
+}
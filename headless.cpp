@@ -0,0 +1,110 @@
+#include "headless.h"
+#include "compiled_rom.h"
+#include "frame_memo.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+InputScript InputScript::Default() {
+    // A keypad walk starting with the keys most games use for movement/fire
+    static const uint8_t order[KEY_COUNT] = {0x5, 0x4, 0x6, 0x8, 0x2, 0x1, 0xC, 0xD,
+                                             0x7, 0x9, 0xE, 0xA, 0x0, 0xB, 0xF, 0x3};
+    InputScript script;
+    for (uint32_t i = 0; i < KEY_COUNT; ++i) {
+        script.events.push_back({i * 15, static_cast<uint16_t>(1u << order[i])});
+        script.events.push_back({i * 15 + 5, 0});
+    }
+    script.period = KEY_COUNT * 15;
+    return script;
+}
+
+
+bool InputScript::LoadFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    events.clear();
+    period = 0;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first)) continue;
+
+        if (first == "period") {
+            fields >> period;
+        } else {
+            InputEvent event{};
+            event.frame = static_cast<uint32_t>(std::stoul(first));
+            std::string keys;
+            fields >> keys;
+            event.keys = static_cast<uint16_t>(std::stoul(keys, nullptr, 16));
+            events.push_back(event);
+        }
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+    return true;
+}
+
+
+uint16_t InputScript::KeysAt(uint32_t frame) const {
+    if (period) frame %= period;
+
+    uint16_t keys = 0;
+    for (const InputEvent& event : events) {
+        if (event.frame > frame) break;
+        keys = event.keys;
+    }
+    return keys;
+}
+
+
+void ApplyKeys(Chip8& chip8, uint16_t keys) {
+    for (unsigned int k = 0; k < KEY_COUNT; ++k) chip8.key[k] = (keys >> k) & 1;
+}
+
+
+uint64_t Fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+
+// Hashed one byte per pixel over the current resolution, so that the hashes
+// do not depend on how the core packs the display
+uint64_t FramebufferHash(const Chip8& chip8) {
+    uint8_t pixels[HIRES_WIDTH * HIRES_HEIGHT];
+    size_t count = 0;
+    for (unsigned int y = 0; y < chip8.DisplayHeight(); ++y) {
+        for (unsigned int word = 0; word < chip8.DisplayWidth() / 64; ++word) {
+            for (int bit = 63; bit >= 0; --bit) pixels[count++] = chip8.display[y][word] >> bit & 1;
+        }
+    }
+    return Fnv1a(pixels, count);
+}
+
+
+uint64_t RunFrames(Chip8& chip8, uint32_t frames, uint32_t cyclesPerFrame, const InputScript& script,
+                   FrameMemo* memo, const CompiledRom* compiled) {
+    uint64_t instructions = 0;
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+        ApplyKeys(chip8, script.KeysAt(frame));
+
+        uint32_t executed;
+        Fault fault = memo ? memo->RunFrame(chip8, cyclesPerFrame, &executed)
+                    : compiled ? compiled->RunCycles(chip8, cyclesPerFrame, &executed)
+                    : chip8.RunCycles(cyclesPerFrame, &executed);
+        instructions += executed;
+        if (fault != Fault::None) break;
+    }
+    return instructions;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <string>
+#include <vector>
+
+// Instructions executed per 60Hz frame by the headless tools. The frontend
+// runs one Cycle() per millisecond, which is roughly 16 per frame.
+const unsigned int CYCLES_PER_FRAME = 16;
+
+
+// Scripted keypad input for headless runs. Each event sets the full keypad
+// state (bit k = key k pressed) from its frame onwards; with a non-zero period
+// the script repeats, frame numbers being taken modulo the period.
+struct InputEvent {
+    uint32_t frame;
+    uint16_t keys;
+};
+
+class InputScript {
+public:
+    // Walks through all 16 keys, holding each one for 5 frames out of 15.
+    // Enough to get past "press any key" screens and move most games around.
+    static InputScript Default();
+
+    // Text file with one "<frame> <hex key mask>" pair per line; a line
+    // "period <frames>" makes the script repeat. '#' starts a comment.
+    bool LoadFile(const std::string& path);
+
+    [[nodiscard]] uint16_t KeysAt(uint32_t frame) const;
+
+private:
+    std::vector<InputEvent> events;     // Sorted by frame
+    uint32_t period{};
+};
+
+
+// Copy a key bitmask into Chip8::key.
+void ApplyKeys(Chip8& chip8, uint16_t keys);
+
+// 64-bit FNV-1a; stable across runs and machines, which is all the tools need.
+uint64_t Fnv1a(const uint8_t* data, size_t size);
+
+// FNV-1a over the framebuffer; identical screens hash identically.
+uint64_t FramebufferHash(const Chip8& chip8);
+
+class FrameMemo;
+class CompiledRom;
+
+// Run `frames` frames of `cyclesPerFrame` instructions, feeding input from the script.
+// Returns the number of instructions executed, which is less if the machine
+// faults (see Chip8::LastFault()). With a memo, frames seen before are replayed
+// rather than run, but still count the instructions they took. Otherwise, with
+// a compiled ROM, frames run its native code (see compiled_rom.h).
+uint64_t RunFrames(Chip8& chip8, uint32_t frames, uint32_t cyclesPerFrame, const InputScript& script,
+                   FrameMemo* memo = nullptr, const CompiledRom* compiled = nullptr);
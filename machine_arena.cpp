@@ -0,0 +1,30 @@
+#include "machine_arena.h"
+
+Chip8* MachineArena::Clone(const Chip8& parent) {
+    Chip8* machine;
+    if (freeList.empty()) {
+        machine = &machines.emplace_back(traceDepth);
+    } else {
+        machine = freeList.back();
+        freeList.pop_back();
+    }
+
+    *machine = parent;
+    return machine;
+}
+
+
+void MachineArena::Release(Chip8* machine) {
+    // Back to the snapshot, which only holds on to pages the parent shares anyway
+    machine->Reset();
+    freeList.push_back(machine);
+}
+
+
+void MachineArena::ReleaseAll() {
+    freeList.clear();
+    for (Chip8& machine : machines) {
+        machine.Reset();
+        freeList.push_back(&machine);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <deque>
+#include <vector>
+
+// Pool of machines for tree search (MCTS and the like), where a position is
+// branched into many children thousands of times per second and whole
+// subtrees are thrown away at once.
+//
+// Clone() copies a machine into a pooled one. Memory pages are shared with
+// the parent copy-on-write, so a child only gets its own copy of a page when
+// it writes to it. Released machines keep their trace buffer and are reused,
+// so once the pool has grown to the size of the working set, cloning
+// allocates nothing.
+class MachineArena {
+public:
+    // Pooled machines keep a shorter trace than a standalone Chip8 does
+    explicit MachineArena(size_t traceDepth = 16) : traceDepth(traceDepth) {}
+
+    MachineArena(const MachineArena&) = delete;
+    MachineArena& operator=(const MachineArena&) = delete;
+
+    Chip8* Clone(const Chip8& parent);
+
+    // Give a machine back; it must have come from this arena. Its pages are
+    // dropped so the parent stops paying for copy-on-write on them.
+    void Release(Chip8* machine);
+    void ReleaseAll();
+
+    [[nodiscard]] size_t Live() const { return machines.size() - freeList.size(); }
+    [[nodiscard]] size_t Capacity() const { return machines.size(); }
+
+private:
+    size_t traceDepth;
+    std::deque<Chip8> machines;         // Never shrinks; a deque so that pointers stay valid as it grows
+    std::vector<Chip8*> freeList;
+};
@@ -1,7 +1,8 @@
 #include "emulator.h"
 
-int main() {
-    Emulator emulator;
+int main(int argc, char* argv[]) {
+    // Optional argument: a ROM directory or a .c8pk archive built with RomPack
+    Emulator emulator(argc > 1 ? argv[1] : ROM_DIRECTORY);
     emulator.Run();
 
     return 0;
@@ -1,15 +1,77 @@
 #include "chip8.h"
 
+#include <bit>
+
 /* Opcodes */
 
 // 00E0 - CLS: Clear the display.
 void Chip8::opcode_00E0() {
     memset(display, 0, sizeof(display));
     drawFlag = true;
+    ++displayWrites;
+}
+
+// 00Cn - SCD nibble: Scroll the display down n rows (SUPER-CHIP). Rows are
+// moved whole; the ones scrolled in at the top are blank.
+void Chip8::opcode_00Cn() {
+    unsigned int rows = opcode & 0x000F, height = DisplayHeight();
+    memmove(display[rows], display[0], (height - rows) * sizeof(display[0]));
+    memset(display[0], 0, rows * sizeof(display[0]));
+    drawFlag = true;
+    ++displayWrites;
+}
+
+// 00FB - SCR: Scroll the display right 4 pixels (SUPER-CHIP). In hires the
+// pixels leaving the first word of a row move into the second.
+void Chip8::opcode_00FB() {
+    if (hires) {
+        for (uint64_t* row : display) {
+            row[1] = row[1] >> 4 | row[0] << 60;
+            row[0] >>= 4;
+        }
+    } else {
+        for (unsigned int y = 0; y < LORES_HEIGHT; ++y) display[y][0] >>= 4;
+    }
+    drawFlag = true;
+    ++displayWrites;
+}
+
+// 00FC - SCL: Scroll the display left 4 pixels (SUPER-CHIP).
+void Chip8::opcode_00FC() {
+    if (hires) {
+        for (uint64_t* row : display) {
+            row[0] = row[0] << 4 | row[1] >> 60;
+            row[1] <<= 4;
+        }
+    } else {
+        for (unsigned int y = 0; y < LORES_HEIGHT; ++y) display[y][0] <<= 4;
+    }
+    drawFlag = true;
+    ++displayWrites;
+}
+
+// 00FD - EXIT: Stop the interpreter (SUPER-CHIP). The PC stays on the
+// instruction, so the machine idles here like a program that jumps to itself.
+void Chip8::opcode_00FD() { pc -= 2; }
+
+// 00FE - LOW: Switch to the 64x32 display (SUPER-CHIP). 00FF - HIGH: Switch
+// to 128x64. Either clears the display, as the later SUPER-CHIP and XO-CHIP
+// interpreters do.
+void Chip8::opcode_00FE() {
+    hires = false;
+    opcode_00E0();
+}
+
+void Chip8::opcode_00FF() {
+    hires = true;
+    opcode_00E0();
 }
 
 // 00EE - RET: Return from a subroutine.
-void Chip8::opcode_00EE() { pc = stack[--sp]; }
+void Chip8::opcode_00EE() {
+    if (sp == 0) return Raise(Fault::StackUnderflow);
+    pc = stack[--sp];
+}
 
 // 1nnn - JP addr: Jump to location nnn. The interpreter sets the program counter to nnn.
 void Chip8::opcode_1nnn() { pc = getNNN(); }
@@ -17,6 +79,7 @@ void Chip8::opcode_1nnn() { pc = getNNN(); }
 // 2nnn - CALL addr: Call subroutine at nnn. The interpreter increments the SP,
 // then puts the current PC on the top of the stack. The PC is then set to nnn.
 void Chip8::opcode_2nnn() {
+    if (sp >= STACK_LEVELS) return Raise(Fault::StackOverflow);
     stack[sp++] = pc;
     pc = getNNN();
 }
@@ -42,13 +105,26 @@ void Chip8::opcode_7xkk() { V[getX()] += getKK(); }
 void Chip8::opcode_8xy0() { V[getX()] = V[getY()]; }
 
 // 8xy1 - OR Vx, Vy: Set Vx = Vx OR Vy. (Bitwise OR)
-void Chip8::opcode_8yx1() { V[getX()] |= V[getY()]; }
+// On the COSMAC VIP the logic ops went through VF and left it cleared (logicResetsVF).
+template <QuirkProfile Q>
+void Chip8::opcode_8yx1() {
+    V[getX()] |= V[getY()];
+    if constexpr (QuirksOf(Q).logicResetsVF) V[0xF] = 0;
+}
 
 // 8xy2 - AND Vx, Vy: Set Vx = Vx AND Vy. (Bitwise AND)
-void Chip8::opcode_8xy2() { V[getX()] &= V[getY()]; }
+template <QuirkProfile Q>
+void Chip8::opcode_8xy2() {
+    V[getX()] &= V[getY()];
+    if constexpr (QuirksOf(Q).logicResetsVF) V[0xF] = 0;
+}
 
 // 8xy3 - XOR Vx, Vy: Set Vx = Vx XOR Vy.
-void Chip8::opcode_8xy3() { V[getX()] ^= V[getY()]; }
+template <QuirkProfile Q>
+void Chip8::opcode_8xy3() {
+    V[getX()] ^= V[getY()];
+    if constexpr (QuirksOf(Q).logicResetsVF) V[0xF] = 0;
+}
 
 // 8xy4 - ADD Vx, Vy: Set Vx = Vx + Vy, set VF = carry.
 // The values of Vx and Vy are added together. If the result is greater than 8 bits (i.e., > 255)
@@ -74,10 +150,18 @@ void Chip8::opcode_8xy5() {
 
 // 8xy6 - SHR Vx {, Vy}: Set Vx = Vx SHR 1.
 // If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
+// The COSMAC VIP shifted Vy into Vx instead (shiftReadsVy), setting VF last.
+template <QuirkProfile Q>
 void Chip8::opcode_8xy6() {
     uint8_t rx = getX();
-    V[0xF] = V[rx] & 0x1;
-    V[rx] >>= 1;
+    if constexpr (QuirksOf(Q).shiftReadsVy) {
+        uint8_t source = V[getY()];
+        V[rx] = source >> 1;
+        V[0xF] = source & 0x1;
+    } else {
+        V[0xF] = V[rx] & 0x1;
+        V[rx] >>= 1;
+    }
 }
 
 // 8xy7 - SUBN Vx, Vy: Set Vx = Vy - Vx, set VF = NOT borrow.
@@ -92,10 +176,17 @@ void Chip8::opcode_8xy7() {
 
 // 8xyE - SHL Vx {, Vy}: Set Vx = Vx SHL 1.
 // If the most-significant bit of Vx is 1, then VF is set to 1, otherwise to 0. Then Vx is multiplied by 2.
+template <QuirkProfile Q>
 void Chip8::opcode_8xyE() {
     uint8_t rx = getX();
-    V[0xF] = (V[rx] & 0x80) >> 7;
-    V[rx] <<= 1;
+    if constexpr (QuirksOf(Q).shiftReadsVy) {
+        uint8_t source = V[getY()];
+        V[rx] = source << 1;
+        V[0xF] = (source & 0x80) >> 7;
+    } else {
+        V[0xF] = (V[rx] & 0x80) >> 7;
+        V[rx] <<= 1;
+    }
 }
 
 // 9xy0 - SNE Vx, Vy: Skip next instruction if Vx != Vy.
@@ -105,10 +196,18 @@ void Chip8::opcode_9xy0() { if (V[getX()] != V[getY()]) pc += 2; }
 void Chip8::opcode_Annn() { I = getNNN(); }
 
 // Bnnn - JP V0, addr: Jump to location nnn + V0.
-void Chip8::opcode_Bnnn() { pc = getNNN() + V[0]; }
+// SUPER-CHIP read it as Bxnn, a jump to xnn + Vx (jumpUsesVx).
+template <QuirkProfile Q>
+void Chip8::opcode_Bnnn() {
+    if constexpr (QuirksOf(Q).jumpUsesVx) pc = getNNN() + V[getX()];
+    else pc = getNNN() + V[0];
+}
 
 // Cxkk - RND Vx, byte: Set Vx = random byte AND kk.
-void Chip8::opcode_Cxkk() { V[getX()] = randByte(randEngine) & getKK(); }
+void Chip8::opcode_Cxkk() {
+    V[getX()] = randByte(randEngine) & getKK();
+    ++randomDraws;
+}
 
 // Dxyn - DRW Vx, Vy, nibble: Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
 // Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels.
@@ -116,34 +215,73 @@ void Chip8::opcode_Cxkk() { V[getX()] = randByte(randEngine) & getKK(); }
 // change after the execution of this instruction.
 // VF is set to 1 if any screen pixels are flipped from set to unset when
 // the sprite is drawn, and to 0 if that does not happen.
+//
+// The starting position wraps around the screen, but the parts of a sprite
+// that go past the right or bottom edge are clipped (as on the COSMAC VIP).
+// XO-CHIP wraps them around to the other side instead (wrapSprites).
+//
+// With the SUPER-CHIP instructions, Dxy0 draws a 16x16 sprite of two bytes a
+// row. Each sprite row is shifted into place and XORed into the packed
+// display row a word at a time; a pixel that was on under the sprite shows up
+// as a set bit in display & sprite.
+template <QuirkProfile Q>
 void Chip8::opcode_Dxyn() {
-    uint8_t x = V[getX()], y = V[getY()];
-    uint8_t height = opcode & 0x000F;
-
-    V[0xF] = 0; // reset VF in case collision does not occur
-
-    for (uint8_t row = 0; row < height; ++row) {
-        uint8_t spriteByte = memory[I + row];
-
-        // Loop through each bit (pixel) in the byte
-        for (uint8_t col = 0; col < 8; ++col) {
-            bool spritePixelIsOn = (spriteByte & (0x80 >> col)) != 0;
-            uint8_t* screenPixel = &display[x + col + (y + row) * DISPLAY_WIDTH];
-
-            if (spritePixelIsOn) {
-                if (*screenPixel) V[0xF] = 1; // collision
-                *screenPixel ^= 1;
-            }
+    constexpr bool wrap = QuirksOf(Q).wrapSprites;
+    const unsigned int height = DisplayHeight();
+    unsigned int x = V[getX()] % DisplayWidth(), y = V[getY()] % height;
+    unsigned int bytesPerRow = QuirksOf(Q).superChipOpcodes && (opcode & 0x000F) == 0 ? 2 : 1;
+
+    unsigned int bytes = SpriteBytes<Q>();
+    if (I + bytes > RAM_SIZE) return Raise(Fault::MemoryOutOfRange);
+
+    uint64_t collision = 0;
+    for (unsigned int offset = 0; offset < bytes; offset += bytesPerRow, ++y) {
+        if (wrap && y == height) y = 0;
+
+        // The sprite row with its leftmost pixel in the high bit, like a display row
+        uint64_t sprite = bytesPerRow == 2 ? static_cast<uint64_t>(Read(I + offset) << 8 | Read(I + offset + 1)) << 48
+                                           : static_cast<uint64_t>(Read(I + offset)) << 56;
+        uint64_t first, second = 0;
+        if (!hires) {
+            first = wrap ? std::rotr(sprite, x) : sprite >> x;
+        } else if (x < 64) {
+            first = sprite >> x;
+            second = x == 0 ? 0 : sprite << (64 - x);
+        } else {
+            first = wrap && x > 64 ? sprite << (128 - x) : 0;
+            second = sprite >> (x - 64);
         }
+
+        uint64_t* row = display[y];
+        collision |= (row[0] & first) | (row[1] & second);
+        row[0] ^= first;
+        row[1] ^= second;
     }
+    V[0xF] = collision != 0 ? 1 : 0;
     drawFlag = true;
+    ++displayWrites;
+}
+
+// The number of sprite bytes Dxyn reads from I. Rows past the bottom edge are
+// not drawn unless they wrap, so their bytes are never read.
+template <QuirkProfile Q>
+unsigned int Chip8::SpriteBytes() const {
+    unsigned int rows = opcode & 0x000F, bytesPerRow = 1;
+    if (QuirksOf(Q).superChipOpcodes && rows == 0) {
+        rows = 16;
+        bytesPerRow = 2;
+    }
+    unsigned int y = V[getY()] % DisplayHeight();
+    if (!QuirksOf(Q).wrapSprites && rows > DisplayHeight() - y) rows = DisplayHeight() - y;
+    return rows * bytesPerRow;
 }
 
 // Ex9E - SKP Vx: Skip next instruction if key with the value of Vx is pressed.
-void Chip8::opcode_Ex9E() { if (key[V[getX()]]) pc += 2; }
+// Only the low nibble of Vx selects a key, as there are just 16 of them.
+void Chip8::opcode_Ex9E() { if (key[V[getX()] & 0xF]) pc += 2; }
 
 // ExA1 - SKNP Vx: Skip next instruction if key with the value of Vx is not pressed.
-void Chip8::opcode_ExA1() { if (!key[V[getX()]]) pc += 2; }
+void Chip8::opcode_ExA1() { if (!key[V[getX()] & 0xF]) pc += 2; }
 
 // Fx07 - LD Vx, DT: Set Vx = delay timer value.
 void Chip8::opcode_Fx07() { V[getX()] = delayTimer; }
@@ -179,107 +317,239 @@ void Chip8::opcode_Fx29() {
     I = spriteAddr;
 }
 
+// Fx30 - LD HF, Vx: Set I = location of the big (8x10) sprite for digit Vx (SUPER-CHIP).
+void Chip8::opcode_Fx30() { I = START_BIG_FONT_ADDRESS + V[getX()] * 10; }
+
 // Fx33 - LD B, Vx: Store BCD representation of Vx in memory locations I, I+1, and I+2.
 void Chip8::opcode_Fx33() {
+    if (I + 3 > RAM_SIZE) return Raise(Fault::MemoryOutOfRange);
+
+    PrepareWrite(I, 3);
     uint8_t value   = V[getX()];
-    memory[I]       = value / 100;          // hundreds
-    memory[I + 1]   = (value % 100) / 10;   // tens
-    memory[I + 2]   = value % 10;           // ones
+    Write(I)        = value / 100;          // hundreds
+    Write(I + 1)    = (value % 100) / 10;   // tens
+    Write(I + 2)    = value % 10;           // ones
 }
 
 // Fx55 - LD [I], Vx: Store registers V0 through Vx (inclusive) in memory starting at location I.
 // The offset from I is increased by 1 for each value written, but I itself is left unmodified.
+// The COSMAC VIP and XO-CHIP leave I just past the last register (loadStoreIncrementsI).
+template <QuirkProfile Q>
 void Chip8::opcode_Fx55() {
     uint8_t rx = getX();
-    for (int i = 0; i < rx + 1; ++i) memory[I + i] = V[i];
+    if (I + rx >= RAM_SIZE) return Raise(Fault::MemoryOutOfRange);
+
+    PrepareWrite(I, rx + 1);
+    for (int i = 0; i < rx + 1; ++i) Write(I + i) = V[i];
+    if constexpr (QuirksOf(Q).loadStoreIncrementsI) I += rx + 1;
 }
 
 // Fx65 - LD Vx, [I]: Read registers V0 through Vx from memory starting at location I.
 // The interpreter reads values from memory starting at location I into registers V0 through Vx.
+template <QuirkProfile Q>
 void Chip8::opcode_Fx65() {
     uint8_t rx = getX();
-    for (int i = 0; i < rx + 1; ++i) V[i] = memory[I + i];
+    if (I + rx >= RAM_SIZE) return Raise(Fault::MemoryOutOfRange);
+
+    for (int i = 0; i < rx + 1; ++i) V[i] = Read(I + i);
+    if constexpr (QuirksOf(Q).loadStoreIncrementsI) I += rx + 1;
 }
 
-// NONE - NOP: Invalid opcode
-void Chip8::opcode_NONE() {
-    std::cout << "Invalid opcode:   " << opcode << std::endl;
-    exit(3);
+// Fx75 - LD R, Vx: Store V0 through Vx in the RPL user flags (SUPER-CHIP).
+// The HP 48 had 8 of them; XO-CHIP has 16, which covers any x.
+void Chip8::opcode_Fx75() {
+    uint8_t rx = getX();
+    for (int i = 0; i < rx + 1; ++i) rplFlags[i] = V[i];
+}
+
+// Fx85 - LD Vx, R: Read V0 through Vx from the RPL user flags (SUPER-CHIP).
+void Chip8::opcode_Fx85() {
+    uint8_t rx = getX();
+    for (int i = 0; i < rx + 1; ++i) V[i] = rplFlags[i];
+}
+
+// Watchpoint checks, for the debug core only (see Chip8::SetWatchpoint()).
+// Each one checks the bytes its opcode is about to access and stops the
+// machine before it does, or runs the opcode. Accesses past the end of
+// memory are left for the opcode to fault on.
+bool Chip8::Watched(const std::bitset<RAM_SIZE>& watch, uint16_t address, unsigned int length) {
+    if (resuming) return false;
+    for (unsigned int i = 0; i < length && address + i < RAM_SIZE; ++i) {
+        if (watch[address + i]) {
+            watchHit = address + i;
+            Raise(Fault::Watchpoint);
+            return true;
+        }
+    }
+    return false;
 }
 
+template <QuirkProfile Q>
+void Chip8::watched_Dxyn() { if (!Watched(debugPoints->readWatch, I, SpriteBytes<Q>())) opcode_Dxyn<Q>(); }
+
+void Chip8::watched_Fx33() { if (!Watched(debugPoints->writeWatch, I, 3)) opcode_Fx33(); }
+
+template <QuirkProfile Q>
+void Chip8::watched_Fx55() { if (!Watched(debugPoints->writeWatch, I, getX() + 1)) opcode_Fx55<Q>(); }
+
+template <QuirkProfile Q>
+void Chip8::watched_Fx65() { if (!Watched(debugPoints->readWatch, I, getX() + 1)) opcode_Fx65<Q>(); }
+
+// NONE - NOP: Invalid opcode
+// Stop this machine; the host decides what to do about it (the frontend dumps
+// the trace, the headless tools report the fault).
+void Chip8::opcode_NONE() { Raise(Fault::InvalidOpcode); }
+
 /* Opcode Table Initialization */
 
-void Chip8::tabulateOpcodes() {
+// Fill in the tables of one QuirkProfile
+template <QuirkProfile Q>
+void Chip8::tabulateProfile() {
+    constexpr unsigned int q = static_cast<unsigned int>(Q);
+
     // The first digit of each opcode runs from 0x0 t0 0xF, hence sizeof(table) = 0xF + 1;
-    table[0x0] = &Chip8::Table0;        // See (*) below
+    table[q][0x0] = &Chip8::Table0<Q>;        // See (*) below
 
-    table[0x1] = &Chip8::opcode_1nnn;
-    table[0x2] = &Chip8::opcode_2nnn;
-    table[0x3] = &Chip8::opcode_3xkk;
-    table[0x4] = &Chip8::opcode_4xkk;
-    table[0x5] = &Chip8::opcode_5xy0;
-    table[0x6] = &Chip8::opcode_6xkk;
-    table[0x7] = &Chip8::opcode_7xkk;
+    table[q][0x1] = &Chip8::opcode_1nnn;
+    table[q][0x2] = &Chip8::opcode_2nnn;
+    table[q][0x3] = &Chip8::opcode_3xkk;
+    table[q][0x4] = &Chip8::opcode_4xkk;
+    table[q][0x5] = &Chip8::opcode_5xy0;
+    table[q][0x6] = &Chip8::opcode_6xkk;
+    table[q][0x7] = &Chip8::opcode_7xkk;
 
-    table[0x8] = &Chip8::Table8;        // See (*) below
+    table[q][0x8] = &Chip8::Table8<Q>;        // See (*) below
 
-    table[0x9] = &Chip8::opcode_9xy0;
-    table[0xA] = &Chip8::opcode_Annn;
-    table[0xB] = &Chip8::opcode_Bnnn;
-    table[0xC] = &Chip8::opcode_Cxkk;
-    table[0xD] = &Chip8::opcode_Dxyn;
+    table[q][0x9] = &Chip8::opcode_9xy0;
+    table[q][0xA] = &Chip8::opcode_Annn;
+    table[q][0xB] = &Chip8::opcode_Bnnn<Q>;
+    table[q][0xC] = &Chip8::opcode_Cxkk;
+    table[q][0xD] = &Chip8::opcode_Dxyn<Q>;
 
-    table[0xE] = &Chip8::TableE;        // See (*) below
-    table[0xF] = &Chip8::TableF;        // See (*) below
+    table[q][0xE] = &Chip8::TableE<Q>;        // See (*) below
+    table[q][0xF] = &Chip8::TableF<Q>;        // See (*) below
 
     // (*) For the opcodes with first digits that repeat ($0, $8, $E, $F),
     // we’ll need secondary tables that can accommodate each of those.
     // The opcodes that are unused are filled with opcode_NONE do indicate an invalid opcode (doing nothing).
-    for (size_t i = 0; i < 0xE + 1; i++) {
-        table0[i] = table8[i] = tableE[i] = &Chip8::opcode_NONE;
+    // The secondary tables are sized to cover every value of the mask used to index them
+    // (see Table0/8/E/F below), so a malformed opcode lands on opcode_NONE instead of
+    // reading past the end of the table.
+    for (size_t i = 0; i < 0xF + 1; i++) {
+        table8[q][i] = tableE[q][i] = &Chip8::opcode_NONE;
+    }
+
+    // $0 needs an array that can index up to $FF+1, since SUPER-CHIP's 00FE
+    // and 00Cn would collide with 00EE and 00E0 on the low nibble. Otherwise
+    // only the low nibble decodes, as it always has here: some old ROMs run
+    // into a 0000 and carry on.
+    for (size_t i = 0; i < 0xFF + 1; i++) {
+        switch (i & 0x000F) {
+            case 0x0: table0[q][i] = &Chip8::opcode_00E0; break;
+            case 0xE: table0[q][i] = &Chip8::opcode_00EE; break;
+            default:  table0[q][i] = &Chip8::opcode_NONE; break;
+        }
     }
+    if constexpr (QuirksOf(Q).superChipOpcodes) {
+        for (size_t n = 0; n < 0xF + 1; n++) table0[q][0xC0 + n] = &Chip8::opcode_00Cn;
+        table0[q][0xFB] = &Chip8::opcode_00FB;
+        table0[q][0xFC] = &Chip8::opcode_00FC;
+        table0[q][0xFD] = &Chip8::opcode_00FD;
+        table0[q][0xFE] = &Chip8::opcode_00FE;
+        table0[q][0xFF] = &Chip8::opcode_00FF;
+    }
+
+    // $8 needs an array that can index up to $F+1
+    table8[q][0x0] = &Chip8::opcode_8xy0;
+    table8[q][0x1] = &Chip8::opcode_8yx1<Q>;
+    table8[q][0x2] = &Chip8::opcode_8xy2<Q>;
+    table8[q][0x3] = &Chip8::opcode_8xy3<Q>;
+    table8[q][0x4] = &Chip8::opcode_8xy4;
+    table8[q][0x5] = &Chip8::opcode_8xy5;
+    table8[q][0x6] = &Chip8::opcode_8xy6<Q>;
+    table8[q][0x7] = &Chip8::opcode_8xy7;
+    table8[q][0xE] = &Chip8::opcode_8xyE<Q>;
+
+    // $E needs an array that can index up to $F+1
+    tableE[q][0x1] = &Chip8::opcode_ExA1;
+    tableE[q][0xE] = &Chip8::opcode_Ex9E;
+
+    // $F needs an array that can index up to $FF+1
+    for (Opcode& f : tableF[q]) f = &Chip8::opcode_NONE;
+    tableF[q][0x07] = &Chip8::opcode_Fx07;
+    tableF[q][0x0A] = &Chip8::opcode_Fx0A;
+    tableF[q][0x15] = &Chip8::opcode_Fx15;
+    tableF[q][0x18] = &Chip8::opcode_Fx18;
+    tableF[q][0x1E] = &Chip8::opcode_Fx1E;
+    tableF[q][0x29] = &Chip8::opcode_Fx29;
+    tableF[q][0x33] = &Chip8::opcode_Fx33;
+    tableF[q][0x55] = &Chip8::opcode_Fx55<Q>;
+    tableF[q][0x65] = &Chip8::opcode_Fx65<Q>;
+    if constexpr (QuirksOf(Q).superChipOpcodes) {
+        tableF[q][0x30] = &Chip8::opcode_Fx30;
+        tableF[q][0x75] = &Chip8::opcode_Fx75;
+        tableF[q][0x85] = &Chip8::opcode_Fx85;
+    }
+
+    // The debug core decodes through copies of these in which the opcodes
+    // that touch memory check for watchpoints first
+    std::copy(std::begin(table[q]), std::end(table[q]), debugTable[q]);
+    std::copy(std::begin(tableF[q]), std::end(tableF[q]), debugTableF[q]);
+    debugTable[q][0xD] = &Chip8::watched_Dxyn<Q>;
+    debugTable[q][0xF] = &Chip8::DebugTableF<Q>;
+    debugTableF[q][0x33] = &Chip8::watched_Fx33;
+    debugTableF[q][0x55] = &Chip8::watched_Fx55<Q>;
+    debugTableF[q][0x65] = &Chip8::watched_Fx65<Q>;
+}
+
 
-    // $0 needs an array that can index up to $E+1
-    table0[0x0] = &Chip8::opcode_00E0;
-    table0[0xE] = &Chip8::opcode_00EE;
-
-    // $8 needs an array that can index up to $E+1
-    table8[0x0] = &Chip8::opcode_8xy0;
-    table8[0x1] = &Chip8::opcode_8yx1;
-    table8[0x2] = &Chip8::opcode_8xy2;
-    table8[0x3] = &Chip8::opcode_8xy3;
-    table8[0x4] = &Chip8::opcode_8xy4;
-    table8[0x5] = &Chip8::opcode_8xy5;
-    table8[0x6] = &Chip8::opcode_8xy6;
-    table8[0x7] = &Chip8::opcode_8xy7;
-    table8[0xE] = &Chip8::opcode_8xyE;
-
-    // $E needs an array that can index up to $E+1
-    tableE[0x1] = &Chip8::opcode_ExA1;
-    tableE[0xE] = &Chip8::opcode_Ex9E;
-
-    // $F needs an array that can index up to $65+1
-    for (Opcode& f : tableF) f = &Chip8::opcode_NONE;
-    tableF[0x07] = &Chip8::opcode_Fx07;
-    tableF[0x0A] = &Chip8::opcode_Fx0A;
-    tableF[0x15] = &Chip8::opcode_Fx15;
-    tableF[0x18] = &Chip8::opcode_Fx18;
-    tableF[0x1E] = &Chip8::opcode_Fx1E;
-    tableF[0x29] = &Chip8::opcode_Fx29;
-    tableF[0x33] = &Chip8::opcode_Fx33;
-    tableF[0x55] = &Chip8::opcode_Fx55;
-    tableF[0x65] = &Chip8::opcode_Fx65;
+void Chip8::tabulateOpcodes() {
+    tabulateProfile<QuirkProfile::Modern>();
+    tabulateProfile<QuirkProfile::CosmacVip>();
+    tabulateProfile<QuirkProfile::SuperChip>();
+    tabulateProfile<QuirkProfile::XoChip>();
+    static_assert(QUIRK_PROFILE_COUNT == 4, "every profile is tabulated");
 }
 
+// Fills the tables once, on first use: from the first Chip8 constructor, or
+// from IsValidOpcode() for the tools that only analyze ROMs and never make one
+void Chip8::tabulateOnce() {
+    static const bool tabulated = (tabulateOpcodes(), true);
+    (void) tabulated;
+}
 
 /* Opcode Retrieval */
 
-void Chip8::Table0() { (this->*table0[opcode & 0x000F])(); }
+template <QuirkProfile Q>
+void Chip8::Table0() { (this->*table0[static_cast<unsigned int>(Q)][opcode & 0x00FF])(); }
+
+template <QuirkProfile Q>
+void Chip8::Table8() { (this->*table8[static_cast<unsigned int>(Q)][opcode & 0x000F])(); }
 
-void Chip8::Table8() { (this->*table8[opcode & 0x000F])(); }
+template <QuirkProfile Q>
+void Chip8::TableE() { (this->*tableE[static_cast<unsigned int>(Q)][opcode & 0x000F])(); }
 
-void Chip8::TableE() { (this->*tableE[opcode & 0x000F])(); }
+template <QuirkProfile Q>
+void Chip8::TableF() { (this->*tableF[static_cast<unsigned int>(Q)][opcode & 0x00FF])(); }
 
-void Chip8::TableF() { (this->*tableF[opcode & 0x00FF])(); }
+template <QuirkProfile Q>
+void Chip8::DebugTableF() { (this->*debugTableF[static_cast<unsigned int>(Q)][opcode & 0x00FF])(); }
+
+
+// Decode through the same tables as Cycle(), without executing anything.
+// The profiles differ only in whether they decode the SUPER-CHIP opcodes.
+bool Chip8::IsValidOpcode(uint16_t op, QuirkProfile profile) {
+    tabulateOnce();
+    unsigned int q = static_cast<unsigned int>(profile);
+    Opcode handler = table[q][(op & 0xF000) >> 12];
+    switch (op & 0xF000) {
+        case 0x0000: handler = table0[q][op & 0x00FF]; break;
+        case 0x8000: handler = table8[q][op & 0x000F]; break;
+        case 0xE000: handler = tableE[q][op & 0x000F]; break;
+        case 0xF000: handler = tableF[q][op & 0x00FF]; break;
+        default: break;
+    }
+    return handler != &Chip8::opcode_NONE;
+}
 
 
@@ -0,0 +1,134 @@
+#include "perf_counters.h"
+
+#include <cstdio>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int OpenCounter(uint32_t type, uint64_t config, int groupFd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;    // Members follow the leader
+    attr.exclude_kernel = 1;                // Allowed with perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+
+PerfCounters::PerfCounters() {
+    static const struct { uint32_t type; uint64_t config; } events[PERF_EVENT_COUNT] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+
+    for (int& fd : fds) fd = -1;
+
+    // Instructions is the group leader; without it none of the ratios mean anything.
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        fds[i] = OpenCounter(events[i].type, events[i].config, leader);
+        if (i == 0) {
+            if (fds[0] < 0) return;
+            leader = fds[0];
+        }
+    }
+}
+
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+
+void PerfCounters::Start() {
+    if (leader < 0) return;
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+
+PerfSample PerfCounters::Stop() {
+    PerfSample sample;
+    if (leader < 0) return sample;
+    ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // PERF_FORMAT_GROUP: { nr, value[nr] } in the order the members were opened
+    uint64_t buffer[1 + PERF_EVENT_COUNT]{};
+    if (read(leader, buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t))) return sample;
+
+    uint64_t slot = 1;
+    for (int i = 0; i < PERF_EVENT_COUNT && slot <= buffer[0]; ++i) {
+        if (fds[i] < 0) continue;
+        sample.value[i] = buffer[slot++];
+        sample.valid[i] = true;
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds) fd = -1;
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::Start() {}
+
+PerfSample PerfCounters::Stop() { return {}; }
+
+#endif
+
+
+void Accumulate(PerfSample& a, const PerfSample& b) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        a.value[i] += b.value[i];
+        a.valid[i] = a.valid[i] && b.valid[i];
+    }
+}
+
+
+void WritePerfJSON(std::ostream& out, const PerfSample& sample, uint64_t emulatedInstructions) {
+    static const char* names[PERF_EVENT_COUNT] = {"instructions", "cycles", "branch_misses", "l1d_misses"};
+    char number[48];
+
+    auto ratio = [&](bool valid, double numerator, double denominator) {
+        if (!valid || denominator == 0) return std::string("null");
+        snprintf(number, sizeof(number), "%.4f", numerator / denominator);
+        return std::string(number);
+    };
+
+    const uint64_t* v = sample.value;
+    const bool* ok = sample.valid;
+    double emulated = static_cast<double>(emulatedInstructions);
+
+    out << "{";
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        out << "\"" << names[i] << "\":";
+        if (ok[i]) out << v[i];
+        else out << "null";
+        out << ",";
+    }
+    out << "\"ipc\":" << ratio(ok[PERF_INSTRUCTIONS] && ok[PERF_CYCLES],
+                                static_cast<double>(v[PERF_INSTRUCTIONS]), static_cast<double>(v[PERF_CYCLES]))
+        << ",\"host_instructions_per_instruction\":"
+        << ratio(ok[PERF_INSTRUCTIONS], static_cast<double>(v[PERF_INSTRUCTIONS]), emulated)
+        << ",\"branch_misses_per_instruction\":"
+        << ratio(ok[PERF_BRANCH_MISSES], static_cast<double>(v[PERF_BRANCH_MISSES]), emulated)
+        << ",\"l1d_misses_per_instruction\":"
+        << ratio(ok[PERF_L1D_MISSES], static_cast<double>(v[PERF_L1D_MISSES]), emulated)
+        << "}";
+}
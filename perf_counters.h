@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Host hardware counters collected with Linux perf_event_open().
+enum PerfEvent {
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_EVENT_COUNT
+};
+
+struct PerfSample {
+    uint64_t value[PERF_EVENT_COUNT]{};
+    bool valid[PERF_EVENT_COUNT]{};     // False for counters the host would not open
+};
+
+
+// A group of user-space counters for the calling thread, started and stopped
+// around an emulation batch. On other platforms, or when the kernel refuses
+// (perf_event_paranoid, containers, VMs without a PMU), Available() is false and
+// the samples are simply marked invalid, so callers never need an #ifdef.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool Available() const { return leader >= 0; }
+
+    void Start();                       // Reset and enable the group
+    PerfSample Stop();                  // Disable the group and read it
+
+private:
+    int leader = -1;
+    int fds[PERF_EVENT_COUNT];
+};
+
+// Adds b into a; a value stays valid only if it is valid in both. Start from
+// the first sample of a series rather than from an empty PerfSample.
+void Accumulate(PerfSample& a, const PerfSample& b);
+
+// Writes a JSON object with the raw counts and the per-emulated-instruction
+// ratios (IPC, host instructions, branch and L1d misses per CHIP-8 instruction).
+// Counters that could not be opened are written as null.
+void WritePerfJSON(std::ostream& out, const PerfSample& sample, uint64_t emulatedInstructions);
@@ -0,0 +1,196 @@
+#include "ram_search.h"
+
+#include <bit>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAM_SEARCH_SSE2 1
+#endif
+
+bool ParseRelation(const std::string& name, SearchRelation& relation) {
+    static const struct {
+        const char* name;
+        SearchRelation relation;
+    } names[] = {
+        {"eq", SearchRelation::Equal},              {"ne", SearchRelation::NotEqual},
+        {"gt", SearchRelation::Greater},            {"lt", SearchRelation::Less},
+        {"changed", SearchRelation::Changed},       {"same", SearchRelation::Unchanged},
+        {"inc", SearchRelation::Increased},         {"dec", SearchRelation::Decreased},
+        {"inc-by", SearchRelation::IncreasedBy},    {"dec-by", SearchRelation::DecreasedBy},
+    };
+    for (const auto& entry : names) {
+        if (name == entry.name) {
+            relation = entry.relation;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+#if RAM_SEARCH_SSE2
+// 0xFF in every lane where the relation holds. SSE2 only compares signed
+// bytes, so the unsigned orderings go through max: a > b <=> max(a, b) == a && a != b.
+static inline __m128i Matches(__m128i now, __m128i before, SearchRelation relation, __m128i operand) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    auto greater = [](__m128i a, __m128i b) {
+        return _mm_andnot_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(_mm_max_epu8(a, b), a));
+    };
+
+    switch (relation) {
+        case SearchRelation::Equal:         return _mm_cmpeq_epi8(now, operand);
+        case SearchRelation::NotEqual:      return _mm_xor_si128(_mm_cmpeq_epi8(now, operand), ones);
+        case SearchRelation::Greater:       return greater(now, operand);
+        case SearchRelation::Less:          return greater(operand, now);
+        case SearchRelation::Changed:       return _mm_xor_si128(_mm_cmpeq_epi8(now, before), ones);
+        case SearchRelation::Unchanged:     return _mm_cmpeq_epi8(now, before);
+        case SearchRelation::Increased:     return greater(now, before);
+        case SearchRelation::Decreased:     return greater(before, now);
+        case SearchRelation::IncreasedBy:   return _mm_cmpeq_epi8(now, _mm_add_epi8(before, operand));
+        case SearchRelation::DecreasedBy:   return _mm_cmpeq_epi8(now, _mm_sub_epi8(before, operand));
+    }
+    return _mm_setzero_si128();
+}
+#else
+static inline bool Matches(uint8_t now, uint8_t before, SearchRelation relation, uint8_t operand) {
+    switch (relation) {
+        case SearchRelation::Equal:         return now == operand;
+        case SearchRelation::NotEqual:      return now != operand;
+        case SearchRelation::Greater:       return now > operand;
+        case SearchRelation::Less:          return now < operand;
+        case SearchRelation::Changed:       return now != before;
+        case SearchRelation::Unchanged:     return now == before;
+        case SearchRelation::Increased:     return now > before;
+        case SearchRelation::Decreased:     return now < before;
+        case SearchRelation::IncreasedBy:   return now == static_cast<uint8_t>(before + operand);
+        case SearchRelation::DecreasedBy:   return now == static_cast<uint8_t>(before - operand);
+    }
+    return false;
+}
+#endif
+
+
+void RamSearch::Reset(const Chip8* const* machines, size_t count) {
+    instances = count;
+    snapshots.resize(count * RAM_SIZE);
+    current.resize(RAM_SIZE);
+    for (size_t i = 0; i < count; ++i) machines[i]->ReadMemory(0, &snapshots[i * RAM_SIZE], RAM_SIZE);
+    for (uint16_t& word : candidates) word = 0xFFFF;
+}
+
+
+size_t RamSearch::Filter(const Chip8* const* machines, SearchRelation relation, uint8_t operand) {
+    for (size_t i = 0; i < instances; ++i) {
+        machines[i]->ReadMemory(0, current.data(), RAM_SIZE);
+        uint8_t* previous = &snapshots[i * RAM_SIZE];
+
+#if RAM_SEARCH_SSE2
+        const __m128i operands = _mm_set1_epi8(static_cast<char>(operand));
+        for (size_t block = 0; block < RAM_SIZE / 16; ++block) {
+            // Most blocks are ruled out after the first filter or two
+            if (candidates[block] == 0) continue;
+            __m128i now = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&current[block * 16]));
+            __m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&previous[block * 16]));
+            candidates[block] &= static_cast<uint16_t>(_mm_movemask_epi8(Matches(now, before, relation, operands)));
+        }
+#else
+        for (size_t block = 0; block < RAM_SIZE / 16; ++block) {
+            if (candidates[block] == 0) continue;
+            uint16_t passed = 0;
+            for (unsigned int bit = 0; bit < 16; ++bit) {
+                size_t address = block * 16 + bit;
+                passed |= Matches(current[address], previous[address], relation, operand) << bit;
+            }
+            candidates[block] &= passed;
+        }
+#endif
+
+        memcpy(previous, current.data(), RAM_SIZE);
+    }
+    return Count();
+}
+
+
+size_t RamSearch::Count() const {
+    size_t count = 0;
+    for (uint16_t word : candidates) count += std::popcount(word);
+    return count;
+}
+
+
+std::vector<uint16_t> RamSearch::Candidates() const {
+    std::vector<uint16_t> addresses;
+    for (size_t block = 0; block < RAM_SIZE / 16; ++block) {
+        for (uint16_t bits = candidates[block]; bits != 0; bits &= bits - 1) {
+            addresses.push_back(static_cast<uint16_t>(block * 16 + std::countr_zero(bits)));
+        }
+    }
+    return addresses;
+}
+
+
+// Parse a whole hex field that fits in `limit`; anything else fails.
+static bool ParseHex(const std::string& field, unsigned long limit, unsigned long& value) {
+    const char* end = field.data() + field.size();
+    auto [next, error] = std::from_chars(field.data(), end, value, 16);
+    return error == std::errc() && next == end && value <= limit;
+}
+
+
+// Lines that don't parse are skipped with a message, so one typo doesn't
+// lose the rest of the file.
+bool LoadCheats(const std::string& path, std::vector<Cheat>& cheats) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    cheats.clear();
+    std::string line;
+    for (unsigned int number = 1; std::getline(file, line); ++number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string address, value;
+        if (!(fields >> address)) continue;
+
+        unsigned long parsedAddress, parsedValue;
+        if (!(fields >> value) || !ParseHex(address, RAM_SIZE - 1, parsedAddress) ||
+            !ParseHex(value, 0xFF, parsedValue)) {
+            std::cerr << path << ":" << number << ": not a cheat, skipped" << std::endl;
+            continue;
+        }
+
+        Cheat cheat{};
+        cheat.address = static_cast<uint16_t>(parsedAddress);
+        cheat.value = static_cast<uint8_t>(parsedValue);
+        std::getline(fields >> std::ws, cheat.name);
+        cheats.push_back(std::move(cheat));
+    }
+    return true;
+}
+
+
+bool SaveCheats(const std::string& path, const std::vector<Cheat>& cheats, const std::string& comment) {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+
+    if (!comment.empty()) file << "# " << comment << "\n";
+    char line[32];
+    for (const Cheat& cheat : cheats) {
+        snprintf(line, sizeof(line), "%03X %02X", cheat.address, cheat.value);
+        file << line;
+        if (!cheat.name.empty()) file << " " << cheat.name;
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+
+void ApplyCheats(Chip8& chip8, const std::vector<Cheat>& cheats) {
+    for (const Cheat& cheat : cheats) {
+        // Poke() would copy a page still shared with the snapshot even when
+        // the value is already right
+        if (chip8.Peek(cheat.address) != cheat.value) chip8.Poke(cheat.address, cheat.value);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <string>
+#include <vector>
+
+// RAM search, the classic way of finding where a game keeps its score or its
+// lives: take a snapshot of memory, play a bit, and keep only the addresses
+// whose value relates to the previous snapshot as expected ("decreased by 1"
+// after losing a life). Each filter compares a new snapshot with the previous
+// one.
+//
+// A search runs over several instances of the same ROM at once, typically
+// given different input: an address survives a filter only if it passes in
+// every instance, which narrows the candidates down much faster. The compares
+// use SSE2 where available, 16 addresses at a time.
+
+enum class SearchRelation : uint8_t {
+    Equal,          // Current value == operand
+    NotEqual,
+    Greater,        // Unsigned
+    Less,
+    Changed,        // Current value vs. previous snapshot
+    Unchanged,
+    Increased,
+    Decreased,
+    IncreasedBy,    // Current == previous + operand (wrapping)
+    DecreasedBy
+};
+
+// Parses the names used by tools/cheat_finder.cpp ("eq", "changed", "inc-by", ...)
+bool ParseRelation(const std::string& name, SearchRelation& relation);
+
+
+class RamSearch {
+public:
+    // Start over: every address is a candidate and the machines' memory is
+    // the first snapshot
+    void Reset(const Chip8* const* machines, size_t count);
+
+    // Snapshot the machines (the same ones, in the same order, as for Reset())
+    // and keep the candidates that satisfy the relation in all of them.
+    // Returns the number of candidates left.
+    size_t Filter(const Chip8* const* machines, SearchRelation relation, uint8_t operand = 0);
+
+    [[nodiscard]] size_t Count() const;
+    [[nodiscard]] std::vector<uint16_t> Candidates() const;
+    [[nodiscard]] size_t Instances() const { return instances; }
+
+    // Value of an address in an instance's latest snapshot
+    [[nodiscard]] uint8_t Value(size_t instance, uint16_t address) const {
+        return snapshots[instance * RAM_SIZE + address];
+    }
+
+private:
+    size_t instances{};
+    std::vector<uint8_t> snapshots;                 // instances * RAM_SIZE bytes
+    std::vector<uint8_t> current;                   // One instance's new snapshot
+    uint16_t candidates[RAM_SIZE / 16]{};           // One bit per address, 16 per word
+};
+
+
+// A value to hold an address at, e.g. found by a RAM search. Cheat files are
+// text, one "<address> <value> [name]" per line in hex; '#' starts a comment.
+// LoadCheats() skips, and reports on std::cerr, lines that are not cheats.
+struct Cheat {
+    uint16_t address;
+    uint8_t value;
+    std::string name;
+};
+
+bool LoadCheats(const std::string& path, std::vector<Cheat>& cheats);
+bool SaveCheats(const std::string& path, const std::vector<Cheat>& cheats, const std::string& comment = "");
+
+// Write the cheats into memory; call once per frame to freeze the values
+void ApplyCheats(Chip8& chip8, const std::vector<Cheat>& cheats);
@@ -0,0 +1,306 @@
+#include "recompiler.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+// Generated code is built up a line at a time
+static void Line(std::string& code, const char* format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    code += line;
+    code += '\n';
+}
+
+
+// Everything the block functions share. Timers tick once per instruction in
+// the interpreter (see Chip8::Step()); compiled code counts the ticks and
+// applies them only where a timer is read or written, or the block is left.
+static const char* PROLOGUE = R"(// Generated by Recompile; see recompiler.h. Do not edit.
+
+#include "compiled_abi.h"
+
+static inline void Tick(CompiledMachine* m, unsigned int ticks) {
+    if (ticks == 0) return;
+    uint8_t delay = *m->delayTimer, sound = *m->soundTimer;
+    *m->delayTimer = delay > ticks ? delay - ticks : 0;
+    *m->soundTimer = sound > ticks ? sound - ticks : 0;
+}
+)";
+
+
+// Each block is written twice. The full version runs the whole block from its
+// start; `done` (instructions completed) and `ticks` (timer ticks not yet
+// applied) are constants along each path through it, so the compiler folds
+// the bookkeeping away. The partial version can be entered at any of the
+// block's instructions and stops after `budget` of them, so that runs of a
+// fixed number of cycles (a frame) need not fall back to the interpreter
+// where they start or end inside a block.
+class BlockWriter {
+public:
+    BlockWriter(std::string& code, const uint8_t* rom, const Quirks& quirks) : code(code), rom(rom), quirks(quirks) {}
+
+    void Write(const BasicBlock& block, bool partial) {
+        Line(code, "");
+        Line(code, "static uint32_t Block%03X%s(CompiledMachine* m, uint32_t budget) {", block.start,
+             partial ? "Partial" : "");
+        Line(code, "    uint8_t* const V = m->V;");
+        Line(code, "    uint32_t done = 0;");
+        Line(code, "    unsigned int ticks = 0;");
+        Line(code, "    (void)V; (void)budget;");
+
+        if (partial && block.end - block.start > 2) {
+            Line(code, "    switch (*m->pc) {");
+            for (uint16_t pc = block.start + 2; pc < block.end; pc += 2) Line(code, "        case 0x%03X: goto I%03X;", pc, pc);
+            Line(code, "        default: break;");
+            Line(code, "    }");
+        }
+
+        for (uint16_t pc = block.start; pc < block.end; pc += 2) {
+            if (partial && pc != block.start) {
+                Line(code, "I%03X:", pc);
+                Line(code, "    if (done == budget) { Tick(m, ticks); *m->pc = 0x%03X; return done; }", pc);
+            }
+            uint16_t opcode = rom[pc - START_INSTRUCTION_ADDRESS] << 8 | rom[pc - START_INSTRUCTION_ADDRESS + 1];
+            Instruction(pc, opcode);
+        }
+
+        // Fell through into the next block (or past an invalid opcode, which
+        // never gets here: the interpreter faults on it)
+        if (block.exit == BlockExit::FallThrough || block.exit == BlockExit::Invalid) {
+            Line(code, "    Tick(m, ticks);");
+            Line(code, "    *m->pc = 0x%03X;", block.end);
+            Line(code, "    return done;");
+        }
+        Line(code, "}");
+    }
+
+private:
+    std::string& code;
+    const uint8_t* rom;
+    const Quirks& quirks;
+
+    void Flush() { Line(code, "    Tick(m, ticks); ticks = 0;"); }
+
+    void ResetFlag() {
+        if (quirks.logicResetsVF) Line(code, "    V[15] = 0;");
+    }
+
+    // Leave the block once the instruction has set the PC
+    void Leave() { Line(code, "    Tick(m, ticks + 1); return done + 1;"); }
+
+    // Run the instruction in the interpreter, which also ticks the timers for
+    // it. The block goes on only if it continued with the next instruction.
+    void Interpret(uint16_t pc) {
+        Flush();
+        Line(code, "    *m->pc = 0x%03X;", pc);
+        Line(code, "    { int next = m->interpret(m); if (next < 0) return done; ++done; if (next != 0x%03X) return done; }",
+             pc + 2);
+    }
+
+    // The stack checks fault in the interpreter, where the fault is raised
+    void InterpretIf(const char* condition, uint16_t pc) {
+        Line(code, "    if (%s) {", condition);
+        Line(code, "        Tick(m, ticks); *m->pc = 0x%03X;", pc);
+        Line(code, "        return m->interpret(m) < 0 ? done : done + 1;");
+        Line(code, "    }");
+    }
+
+    void Skip(uint16_t pc, const char* condition) {
+        Line(code, "    *m->pc = (%s) ? 0x%03X : 0x%03X;", condition, pc + 4, pc + 2);
+        Leave();
+    }
+
+    // Decoded the way the core's dispatch tables decode (see tabulateOpcodes())
+    void Instruction(uint16_t pc, uint16_t opcode) {
+        unsigned int x = (opcode & 0x0F00) >> 8, y = (opcode & 0x00F0) >> 4;
+        unsigned int kk = opcode & 0x00FF, nnn = opcode & 0x0FFF;
+        char condition[64];
+
+        Line(code, "    // %03X: %04X", pc, opcode);
+        switch (opcode & 0xF000) {
+            case 0x0000:
+                // Decoded on the low nibble, except for SUPER-CHIP's 00Cn and 00FE
+                if ((opcode & 0x000F) == 0xE && !(quirks.superChipOpcodes && (kk == 0xFE || (kk & 0xF0) == 0xC0))) {
+                    InterpretIf("*m->sp == 0", pc);
+                    Line(code, "    *m->pc = m->stack[--*m->sp];");
+                    Leave();
+                } else {
+                    Interpret(pc);      // 00E0 and the SUPER-CHIP display opcodes; the rest are invalid
+                }
+                return;
+            case 0x1000:
+                Line(code, "    *m->pc = 0x%03X;", nnn);
+                Leave();
+                return;
+            case 0x2000:
+                InterpretIf("*m->sp >= 16", pc);
+                Line(code, "    m->stack[(*m->sp)++] = 0x%03X;", pc + 2);
+                Line(code, "    *m->pc = 0x%03X;", nnn);
+                Leave();
+                return;
+            case 0x3000:
+                snprintf(condition, sizeof(condition), "V[%u] == 0x%02X", x, kk);
+                return Skip(pc, condition);
+            case 0x4000:
+                snprintf(condition, sizeof(condition), "V[%u] != 0x%02X", x, kk);
+                return Skip(pc, condition);
+            case 0x5000:
+                snprintf(condition, sizeof(condition), "V[%u] == V[%u]", x, y);
+                return Skip(pc, condition);
+            case 0x6000: Line(code, "    V[%u] = 0x%02X;", x, kk); break;
+            case 0x7000: Line(code, "    V[%u] += 0x%02X;", x, kk); break;
+            case 0x8000:
+                switch (opcode & 0x000F) {
+                    case 0x0: Line(code, "    V[%u] = V[%u];", x, y); break;
+                    case 0x1: Line(code, "    V[%u] |= V[%u];", x, y); ResetFlag(); break;
+                    case 0x2: Line(code, "    V[%u] &= V[%u];", x, y); ResetFlag(); break;
+                    case 0x3: Line(code, "    V[%u] ^= V[%u];", x, y); ResetFlag(); break;
+                    case 0x4:
+                        Line(code, "    { uint16_t sum = V[%u] + V[%u]; V[15] = sum > 0xFF ? 1 : 0; V[%u] = sum & 0xFF; }",
+                             x, y, x);
+                        break;
+                    case 0x5: Line(code, "    V[15] = V[%u] > V[%u] ? 1 : 0; V[%u] -= V[%u];", x, y, x, y); break;
+                    case 0x6:
+                        if (quirks.shiftReadsVy) {
+                            Line(code, "    { uint8_t source = V[%u]; V[%u] = source >> 1; V[15] = source & 0x1; }", y, x);
+                        } else {
+                            Line(code, "    V[15] = V[%u] & 0x1; V[%u] >>= 1;", x, x);
+                        }
+                        break;
+                    case 0x7: Line(code, "    V[15] = V[%u] > V[%u] ? 1 : 0; V[%u] = V[%u] - V[%u];", y, x, x, y, x); break;
+                    case 0xE:
+                        if (quirks.shiftReadsVy) {
+                            Line(code, "    { uint8_t source = V[%u]; V[%u] = source << 1; V[15] = (source & 0x80) >> 7; }",
+                                 y, x);
+                        } else {
+                            Line(code, "    V[15] = (V[%u] & 0x80) >> 7; V[%u] <<= 1;", x, x);
+                        }
+                        break;
+                    default: return Interpret(pc);
+                }
+                break;
+            case 0x9000:
+                snprintf(condition, sizeof(condition), "V[%u] != V[%u]", x, y);
+                return Skip(pc, condition);
+            case 0xA000: Line(code, "    *m->I = 0x%03X;", nnn); break;
+            case 0xB000:
+                if (quirks.jumpUsesVx) Line(code, "    *m->pc = 0x%03X + V[%u];", nnn, x);
+                else Line(code, "    *m->pc = 0x%03X + V[0];", nnn);
+                Leave();
+                return;
+            case 0xE000:
+                if ((opcode & 0x000F) == 0xE) {
+                    snprintf(condition, sizeof(condition), "m->key[V[%u] & 0xF]", x);
+                    return Skip(pc, condition);
+                }
+                if ((opcode & 0x000F) == 0x1) {
+                    snprintf(condition, sizeof(condition), "!m->key[V[%u] & 0xF]", x);
+                    return Skip(pc, condition);
+                }
+                return Interpret(pc);
+            case 0xF000:
+                switch (kk) {
+                    case 0x07: Flush(); Line(code, "    V[%u] = *m->delayTimer;", x); break;
+                    case 0x15: Flush(); Line(code, "    *m->delayTimer = V[%u];", x); break;
+                    case 0x18: Flush(); Line(code, "    *m->soundTimer = V[%u];", x); break;
+                    case 0x1E: Line(code, "    *m->I += V[%u];", x); break;
+                    case 0x29: Line(code, "    *m->I = 0x%03X + V[%u] * 5;", START_FONT_SET_ADDRESS, x); break;
+                    default: return Interpret(pc);
+                }
+                break;
+            default:
+                return Interpret(pc);       // Cxkk and Dxyn
+        }
+        Line(code, "    ++done; ++ticks;");
+    }
+};
+
+
+// The blocks to generate, hottest first according to the profile
+static std::vector<BasicBlock> ChooseBlocks(const uint8_t* rom, size_t size, const RomProfile* profile,
+                                            QuirkProfile quirks) {
+    RomAnalysis analysis = AnalyzeRom(rom, size, quirks);
+    if (!profile) return analysis.blocks;
+
+    std::vector<uint16_t> entries;
+    for (uint16_t address : profile->Hot()) {
+        if (!(analysis.flags[address] & BYTE_INSTRUCTION)) entries.push_back(address);
+    }
+    if (!entries.empty()) analysis = AnalyzeRom(rom, size, quirks, entries);
+
+    std::vector<BasicBlock> blocks;
+    std::vector<uint64_t> heat;
+    for (const BasicBlock& block : analysis.blocks) {
+        bool modified = false;
+        uint64_t executed = 0;
+        for (unsigned int address = block.start; address < block.end; ++address) {
+            modified |= profile->modified[address];
+            executed += profile->counts[address];
+        }
+        if (modified) continue;
+        blocks.push_back(block);
+        heat.push_back(executed);
+    }
+
+    std::vector<size_t> order(blocks.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return heat[a] > heat[b]; });
+
+    std::vector<BasicBlock> sorted;
+    for (size_t i : order) sorted.push_back(blocks[i]);
+    return sorted;
+}
+
+
+size_t GenerateCpp(const uint8_t* rom, size_t size, std::ostream& out, const RomProfile* profile,
+                   QuirkProfile quirks) {
+    if (size > MAX_ROM_SIZE) size = MAX_ROM_SIZE;
+    std::vector<BasicBlock> blocks = ChooseBlocks(rom, size, profile, quirks);
+
+    std::string code = PROLOGUE;
+    BlockWriter writer(code, rom, QuirksOf(quirks));
+    for (const BasicBlock& block : blocks) {
+        writer.Write(block, false);
+        writer.Write(block, true);
+    }
+
+    Line(code, "");
+    // Both arrays end in an entry that is not counted, so that neither is empty
+    Line(code, "static const uint8_t rom[] = {");
+    for (size_t i = 0; i < size; i += 16) {
+        std::string row = "   ";
+        for (size_t j = i; j < size && j < i + 16; ++j) {
+            char byte[8];
+            snprintf(byte, sizeof(byte), " 0x%02X,", rom[j]);
+            row += byte;
+        }
+        Line(code, "%s", row.c_str());
+    }
+    Line(code, "    0");
+    Line(code, "};");
+
+    Line(code, "");
+    Line(code, "static const CompiledBlock blocks[] = {");
+    for (const BasicBlock& block : blocks) {
+        Line(code, "    {0x%03X, %u, Block%03X, Block%03XPartial},", block.start, (block.end - block.start) / 2,
+             block.start, block.start);
+    }
+    Line(code, "    {0, 0, 0, 0}");
+    Line(code, "};");
+
+    Line(code, "");
+    Line(code, "static const CompiledModule module = {CHIP8_COMPILED_ABI, %zu, rom, %u, %zu, blocks};", size,
+         static_cast<unsigned int>(quirks), blocks.size());
+    Line(code, "");
+    Line(code, "extern \"C\" __attribute__((visibility(\"default\"))) const CompiledModule* chip8_compiled_module() {");
+    Line(code, "    return &module;");
+    Line(code, "}");
+
+    out << code;
+    return blocks.size();
+}
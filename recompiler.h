@@ -0,0 +1,33 @@
+#pragma once
+
+#include "rom_analysis.h"
+#include "rom_profile.h"
+
+#include <ostream>
+
+// Ahead-of-time recompiler from a ROM to C++.
+//
+// Every basic block found by AnalyzeRom() becomes a C++ function that runs
+// its instructions on the machine's registers directly, and the module
+// exports a table of them keyed by start address (see compiled_abi.h).
+// Register, ALU, timer, jump, call, return and skip instructions are compiled;
+// the ones that touch memory, the screen or the RNG, Fx0A and invalid opcodes
+// call back into the interpreter, so they behave exactly as they do there.
+// Jumps through Bnnn and 00EE just set the PC and leave the block: the
+// dispatcher in CompiledRom looks up the next block from it, and interprets
+// whatever no block covers.
+//
+// With a profile of the ROM (rom_profile.h), the addresses it executed that
+// the static analysis did not reach become block starts too, blocks whose
+// code it saw modified are left to the interpreter, and the hottest blocks
+// are written first so that they end up next to each other in the binary.
+//
+// The code follows the given quirks (see Chip8::SetQuirks()), and CompiledRom
+// only runs it on machines set to the same.
+//
+// The output includes only compiled_abi.h; the Recompile tool compiles it
+// into a shared object that CompiledRom loads.
+//
+// Returns the number of blocks generated.
+size_t GenerateCpp(const uint8_t* rom, size_t size, std::ostream& out, const RomProfile* profile = nullptr,
+                   QuirkProfile quirks = QuirkProfile::Modern);
@@ -0,0 +1,234 @@
+#include "rom_analysis.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// Skips: the next instruction is either executed or stepped over
+static bool IsSkip(uint16_t opcode) {
+    switch (opcode & 0xF000) {
+        case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xE000: return true;
+        default: return false;
+    }
+}
+
+
+RomAnalysis AnalyzeRom(const uint8_t* rom, size_t size, QuirkProfile quirks, const std::vector<uint16_t>& entries) {
+    RomAnalysis analysis;
+    uint8_t* flags = analysis.flags;
+    const bool superChip = QuirksOf(quirks).superChipOpcodes;      // Dxy0 draws 16x16 from 32 bytes
+    const bool stepsIndex = QuirksOf(quirks).loadStoreIncrementsI;  // Fx55/Fx65 leave I past the registers
+
+    const uint16_t romEnd = static_cast<uint16_t>(START_INSTRUCTION_ADDRESS + std::min<size_t>(size, MAX_ROM_SIZE));
+    auto inRom = [&](unsigned int address) { return address >= START_INSTRUCTION_ADDRESS && address + 1 < romEnd; };
+    auto fetch = [&](uint16_t address) -> uint16_t {
+        return rom[address - START_INSTRUCTION_ADDRESS] << 8 | rom[address - START_INSTRUCTION_ADDRESS + 1];
+    };
+
+    // Pass 1: find every reachable instruction and where blocks start.
+    // Control flow only leaves the ROM by jumping out of it, and what is out
+    // there is not known statically, so such targets are not followed.
+    std::vector<uint16_t> work;
+    auto reach = [&](unsigned int address, bool blockStart) {
+        address &= RAM_SIZE - 1;
+        if (blockStart) flags[address] |= BYTE_BLOCK_START;
+        if (inRom(address) && !(flags[address] & BYTE_INSTRUCTION)) {
+            flags[address] |= BYTE_INSTRUCTION;
+            work.push_back(static_cast<uint16_t>(address));
+        }
+    };
+    reach(START_INSTRUCTION_ADDRESS, true);
+    for (uint16_t entry : entries) reach(entry, true);
+
+    while (!work.empty()) {
+        uint16_t pc = work.back();
+        work.pop_back();
+        flags[pc] |= BYTE_CODE;
+        flags[pc + 1] |= BYTE_CODE;
+
+        uint16_t opcode = fetch(pc);
+        uint16_t nnn = opcode & 0x0FFF;
+
+        if (!Chip8::IsValidOpcode(opcode, quirks)) continue;
+        switch (opcode & 0xF000) {
+            case 0x1000: reach(nnn, true); break;
+            case 0x2000: reach(nnn, true); reach(pc + 2, true); break;
+            case 0xB000: reach(nnn, true); break;
+            default:
+                if (opcode == 0x00EE || opcode == 0x00FD) break;
+                if (IsSkip(opcode)) {
+                    reach(pc + 2, true);
+                    reach(pc + 4, true);
+                } else {
+                    reach(pc + 2, false);
+                }
+        }
+    }
+
+    // Pass 2: cut the reachable code into blocks, following I within each
+    // one to find what the memory opcodes touch
+    auto mark = [&](int I, unsigned int length, uint8_t flag) {
+        if (I < 0) return;
+        for (unsigned int i = 0; i < length && I + i < RAM_SIZE; ++i) flags[I + i] |= flag;
+    };
+
+    // Every reachable instruction is either a block start or follows one that
+    // falls through, so walking from the block starts covers all of them.
+    for (unsigned int start = START_INSTRUCTION_ADDRESS; start < romEnd; ++start) {
+        if ((flags[start] & (BYTE_INSTRUCTION | BYTE_BLOCK_START)) != (BYTE_INSTRUCTION | BYTE_BLOCK_START)) continue;
+
+        BasicBlock block{static_cast<uint16_t>(start), static_cast<uint16_t>(start), BlockExit::FallThrough, 0, {}};
+        int I = -1;     // Unknown
+        uint16_t pc = static_cast<uint16_t>(start);
+
+        for (;;) {
+            uint16_t opcode = fetch(pc);
+            uint16_t nnn = opcode & 0x0FFF;
+            uint8_t x = (opcode & 0x0F00) >> 8;
+            block.end = pc + 2;
+
+            if (!Chip8::IsValidOpcode(opcode, quirks)) {
+                block.exit = BlockExit::Invalid;
+                break;
+            }
+
+            switch (opcode & 0xF000) {
+                case 0xA000: I = nnn; break;
+                case 0xD000: mark(I, (opcode & 0x000F) == 0 && superChip ? 32 : opcode & 0x000F, BYTE_SPRITE); break;
+                case 0xF000:
+                    switch (opcode & 0x00FF) {
+                        case 0x33: mark(I, 3, BYTE_WRITTEN); break;
+                        // Where the profile moves I past the registers, a second
+                        // store or load reaches the bytes after these
+                        case 0x55:
+                            mark(I, x + 1, BYTE_WRITTEN);
+                            if (stepsIndex && I >= 0) I += x + 1;
+                            break;
+                        case 0x65:
+                            mark(I, x + 1, BYTE_DATA);
+                            if (stepsIndex && I >= 0) I += x + 1;
+                            break;
+                        case 0x1E: case 0x29: case 0x30: I = -1; break;
+                        default: break;
+                    }
+                    break;
+                default: break;
+            }
+
+            if ((opcode & 0xF000) == 0x1000) {
+                block.exit = nnn == pc ? BlockExit::Halt : BlockExit::Jump;
+                block.successors[block.successorCount++] = nnn;
+                break;
+            }
+            if ((opcode & 0xF000) == 0x2000) {
+                block.exit = BlockExit::Call;
+                block.successors[block.successorCount++] = nnn;
+                block.successors[block.successorCount++] = pc + 2;
+                break;
+            }
+            if ((opcode & 0xF000) == 0xB000) {
+                block.exit = BlockExit::Indirect;
+                block.successors[block.successorCount++] = nnn;
+                break;
+            }
+            if (opcode == 0x00EE) {
+                block.exit = BlockExit::Return;
+                break;
+            }
+            if (opcode == 0x00FD) {
+                block.exit = BlockExit::Halt;       // SUPER-CHIP EXIT idles on itself
+                break;
+            }
+            if (IsSkip(opcode)) {
+                block.exit = BlockExit::Skip;
+                block.successors[block.successorCount++] = pc + 2;
+                block.successors[block.successorCount++] = pc + 4;
+                break;
+            }
+
+            // Falls through; the block ends where another one starts
+            pc += 2;
+            if (!inRom(pc) || (flags[pc] & BYTE_BLOCK_START)) {
+                block.exit = BlockExit::FallThrough;
+                block.successors[block.successorCount++] = pc;
+                break;
+            }
+        }
+
+        analysis.blocks.push_back(block);
+    }
+    return analysis;
+}
+
+
+const BasicBlock* RomAnalysis::BlockAt(uint16_t address) const {
+    // Blocks do not overlap unless code jumps into the middle of an
+    // instruction, so the last block starting at or before the address is it
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), address,
+                               [](uint16_t a, const BasicBlock& block) { return a < block.start; });
+    if (it == blocks.begin()) return nullptr;
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+
+std::vector<uint16_t> RomAnalysis::SelfModifying() const {
+    std::vector<uint16_t> addresses;
+    for (unsigned int address = 0; address < RAM_SIZE; ++address) {
+        if ((flags[address] & (BYTE_CODE | BYTE_WRITTEN)) == (BYTE_CODE | BYTE_WRITTEN)) {
+            addresses.push_back(static_cast<uint16_t>(address));
+        }
+    }
+    return addresses;
+}
+
+
+static const char* ExitName(BlockExit exit) {
+    switch (exit) {
+        case BlockExit::FallThrough:  return "fall-through";
+        case BlockExit::Jump:         return "jump";
+        case BlockExit::Skip:         return "skip";
+        case BlockExit::Call:         return "call";
+        case BlockExit::Return:       return "return";
+        case BlockExit::Indirect:     return "indirect";
+        case BlockExit::Halt:         return "halt";
+        case BlockExit::Invalid:      return "invalid";
+    }
+    return "?";
+}
+
+
+// Runs of addresses with all of `flag` set, as "200-20F 300-303"
+static void DumpRanges(std::ostream& out, const RomAnalysis& analysis, uint8_t flag, const char* label) {
+    char line[32];
+    bool any = false;
+    for (unsigned int address = 0; address < RAM_SIZE; ++address) {
+        if ((analysis.flags[address] & flag) != flag) continue;
+        unsigned int last = address;
+        while (last + 1 < RAM_SIZE && (analysis.flags[last + 1] & flag) == flag) ++last;
+
+        if (!any) out << label << ":";
+        any = true;
+        snprintf(line, sizeof(line), " %03X-%03X", address, last);
+        out << line;
+        address = last;
+    }
+    if (any) out << "\n";
+}
+
+
+void DumpAnalysis(std::ostream& out, const RomAnalysis& analysis) {
+    char line[96];
+    for (const BasicBlock& block : analysis.blocks) {
+        int length = snprintf(line, sizeof(line), "%03X-%03X  %-12s", block.start, block.end - 1, ExitName(block.exit));
+        for (unsigned int i = 0; i < block.successorCount && length < static_cast<int>(sizeof(line)); ++i) {
+            length += snprintf(line + length, sizeof(line) - length, " %03X", block.successors[i]);
+        }
+        out << line << "\n";
+    }
+
+    DumpRanges(out, analysis, BYTE_SPRITE, "sprites");
+    DumpRanges(out, analysis, BYTE_DATA, "data");
+    DumpRanges(out, analysis, BYTE_WRITTEN, "written");
+    DumpRanges(out, analysis, BYTE_CODE | BYTE_WRITTEN, "self-modifying");
+    out.flush();
+}
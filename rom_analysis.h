@@ -0,0 +1,71 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <ostream>
+#include <vector>
+
+// Static analysis of a ROM image, cheap enough to run whenever one is loaded
+// (a few microseconds for the ROMs in roms/).
+//
+// Starting at START_INSTRUCTION_ADDRESS, every instruction reachable through
+// fall-through, jumps, calls and skips is decoded, and the reachable code is
+// cut into basic blocks. Within a block the value of I is tracked from Annn
+// (and past the registers after Fx55/Fx65 in the profiles that move it), so
+// that the bytes a Dxyn draws are marked as sprite data, the bytes Fx65
+// loads as data, and the bytes Fx33/Fx55 store to as written. Code that is
+// also written is likely self-modifying.
+//
+// The analysis is conservative where it cannot know: Bnnn (jump to nnn + V0)
+// ends a block with no known successors apart from nnn itself, and I set by
+// anything but Annn is not followed. Bytes that nothing reaches stay unmarked.
+
+// Per-address flags
+const uint8_t BYTE_INSTRUCTION  = 1 << 0;   // First byte of a reachable instruction
+const uint8_t BYTE_CODE         = 1 << 1;   // Either byte of a reachable instruction
+const uint8_t BYTE_SPRITE       = 1 << 2;   // Drawn by a Dxyn
+const uint8_t BYTE_DATA         = 1 << 3;   // Loaded into registers by Fx65
+const uint8_t BYTE_WRITTEN      = 1 << 4;   // Stored to by Fx33 or Fx55
+const uint8_t BYTE_BLOCK_START  = 1 << 5;
+
+enum class BlockExit : uint8_t {
+    FallThrough,        // Runs into the next block, which starts at a jump target
+    Jump,               // 1nnn
+    Skip,               // 3xkk, 4xkk, 5xy0, 9xy0, Ex9E, ExA1: the next instruction or the one after
+    Call,               // 2nnn: the subroutine, then the instruction after the call
+    Return,             // 00EE
+    Indirect,           // Bnnn
+    Halt,               // A jump to itself, the usual way to end a program (or SUPER-CHIP 00FD)
+    Invalid             // An opcode the core faults on
+};
+
+struct BasicBlock {
+    uint16_t start;
+    uint16_t end;                   // Address after the last instruction
+    BlockExit exit;
+    uint8_t successorCount;
+    uint16_t successors[2];
+};
+
+struct RomAnalysis {
+    uint8_t flags[RAM_SIZE]{};
+    std::vector<BasicBlock> blocks;             // Sorted by start address
+
+    [[nodiscard]] bool IsCode(uint16_t address) const { return flags[address & (RAM_SIZE - 1)] & BYTE_CODE; }
+
+    // The block containing an instruction start, or nullptr
+    [[nodiscard]] const BasicBlock* BlockAt(uint16_t address) const;
+
+    // Code bytes that some instruction writes to
+    [[nodiscard]] std::vector<uint16_t> SelfModifying() const;
+};
+
+// Opcodes decode as they do in the `quirks` profile the ROM runs with (see
+// DetectQuirks()). `entries` are further addresses where code is known to
+// start, besides START_INSTRUCTION_ADDRESS (e.g. the Bnnn targets a
+// RomProfile saw).
+RomAnalysis AnalyzeRom(const uint8_t* rom, size_t size, QuirkProfile quirks,
+                       const std::vector<uint16_t>& entries = {});
+
+// Human-readable block map, sprite/data ranges and self-modifying regions
+void DumpAnalysis(std::ostream& out, const RomAnalysis& analysis);
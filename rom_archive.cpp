@@ -0,0 +1,168 @@
+#include "rom_archive.h"
+#include "chip8.h"
+#include "headless.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ROM_ARCHIVE_MMAP 1
+#endif
+
+static uint32_t Read32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+static uint64_t Read64(const uint8_t* p) {
+    return Read32(p) | static_cast<uint64_t>(Read32(p + 4)) << 32;
+}
+
+static void Write32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void Write64(std::vector<uint8_t>& out, uint64_t value) {
+    Write32(out, value & 0xFFFFFFFF);
+    Write32(out, value >> 32);
+}
+
+
+RomArchive::~RomArchive() { Close(); }
+
+
+bool RomArchive::Open(const std::string& path) {
+    Close();
+
+#ifdef ROM_ARCHIVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            base = static_cast<const uint8_t*>(mapping);
+            length = static_cast<size_t>(info.st_size);
+            mapped = true;
+        }
+    }
+    close(fd);
+#endif
+
+    if (!base) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+        fallbackBuffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(fallbackBuffer.data()), static_cast<std::streamsize>(fallbackBuffer.size()));
+        base = fallbackBuffer.data();
+        length = fallbackBuffer.size();
+    }
+
+    // Validate everything up front so that lookups never need bounds checks
+    bool valid = length >= ROM_ARCHIVE_HEADER_SIZE && std::equal(base, base + 4, "C8PK") &&
+                 Read32(base + 4) == ROM_ARCHIVE_VERSION;
+    if (valid) {
+        count = Read32(base + 8);
+        indexOffset = Read32(base + 12);
+        namesOffset = Read32(base + 16);
+        valid = indexOffset <= length && count <= (length - indexOffset) / ROM_ARCHIVE_ENTRY_SIZE &&
+                namesOffset <= length;
+    }
+    for (size_t i = 0; valid && i < count; ++i) {
+        const uint8_t* entry = base + indexOffset + i * ROM_ARCHIVE_ENTRY_SIZE;
+        uint64_t nameEnd = static_cast<uint64_t>(namesOffset) + Read32(entry) + Read32(entry + 4);
+        uint64_t dataEnd = static_cast<uint64_t>(Read32(entry + 12)) + Read32(entry + 8);
+        valid = nameEnd <= length && dataEnd <= length && Read32(entry + 8) <= MAX_ROM_SIZE &&
+                (i == 0 || At(i - 1).name < At(i).name);
+    }
+
+    if (!valid) Close();
+    return valid;
+}
+
+
+void RomArchive::Close() {
+#ifdef ROM_ARCHIVE_MMAP
+    if (mapped) munmap(const_cast<uint8_t*>(base), length);
+#endif
+    base = nullptr;
+    length = count = 0;
+    mapped = false;
+    fallbackBuffer.clear();
+}
+
+
+ArchivedRom RomArchive::At(size_t i) const {
+    const uint8_t* entry = base + indexOffset + i * ROM_ARCHIVE_ENTRY_SIZE;
+    return {std::string_view(reinterpret_cast<const char*>(base + namesOffset + Read32(entry)), Read32(entry + 4)),
+            Read64(entry + 16), base + Read32(entry + 12), Read32(entry + 8)};
+}
+
+
+bool RomArchive::Find(std::string_view name, ArchivedRom& rom) const {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        ArchivedRom candidate = At(middle);
+        if (candidate.name == name) {
+            rom = candidate;
+            return true;
+        }
+        if (candidate.name < name) low = middle + 1;
+        else high = middle;
+    }
+    return false;
+}
+
+
+bool RomArchive::Write(const std::string& path, std::vector<RomToPack> roms) {
+    std::sort(roms.begin(), roms.end(), [](const RomToPack& a, const RomToPack& b) { return a.name < b.name; });
+    for (size_t i = 0; i < roms.size(); ++i) {
+        if (roms[i].bytes.size() > MAX_ROM_SIZE || (i > 0 && roms[i].name == roms[i - 1].name)) return false;
+    }
+
+    auto align = [](size_t offset) { return (offset + ROM_ARCHIVE_ALIGNMENT - 1) & ~size_t(ROM_ARCHIVE_ALIGNMENT - 1); };
+
+    uint32_t indexOffset = ROM_ARCHIVE_HEADER_SIZE;
+    uint32_t namesOffset = indexOffset + static_cast<uint32_t>(roms.size()) * ROM_ARCHIVE_ENTRY_SIZE;
+    size_t namesSize = 0;
+    for (const RomToPack& rom : roms) namesSize += rom.name.size();
+    size_t payloadOffset = align(namesOffset + namesSize);
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'C', '8', 'P', 'K'});
+    Write32(out, ROM_ARCHIVE_VERSION);
+    Write32(out, static_cast<uint32_t>(roms.size()));
+    Write32(out, indexOffset);
+    Write32(out, namesOffset);
+    Write32(out, static_cast<uint32_t>(payloadOffset));
+    Write64(out, 0);
+
+    uint32_t nameOffset = 0;
+    size_t dataOffset = payloadOffset;
+    for (const RomToPack& rom : roms) {
+        Write32(out, nameOffset);
+        Write32(out, static_cast<uint32_t>(rom.name.size()));
+        Write32(out, static_cast<uint32_t>(rom.bytes.size()));
+        Write32(out, static_cast<uint32_t>(dataOffset));
+        Write64(out, Fnv1a(rom.bytes.data(), rom.bytes.size()));
+        Write64(out, 0);
+        nameOffset += static_cast<uint32_t>(rom.name.size());
+        dataOffset = align(dataOffset + rom.bytes.size());
+    }
+    for (const RomToPack& rom : roms) out.insert(out.end(), rom.name.begin(), rom.name.end());
+    for (const RomToPack& rom : roms) {
+        out.resize(align(out.size()), 0);
+        out.insert(out.end(), rom.bytes.begin(), rom.bytes.end());
+    }
+    if (dataOffset > UINT32_MAX) return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
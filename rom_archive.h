@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single-file ROM archive (.c8pk). All integers are little-endian.
+//
+//   header   32 bytes   "C8PK", version, entry count, index offset, names offset, payload offset, 2 reserved
+//   index    32 bytes per entry, sorted by name (byte-wise):
+//            name offset (into the name table), name length, size, payload offset, FNV-1a hash, 2 reserved
+//   names    the entry names, back to back, not NUL-terminated
+//   payload  the ROM images, each starting on a ROM_ARCHIVE_ALIGNMENT boundary
+//
+// The archive is memory-mapped read-only, so looking a ROM up is a binary
+// search over the index and loading it is a single copy from the mapping
+// straight into Chip8::memory.
+
+const uint32_t ROM_ARCHIVE_VERSION      = 1;
+const uint32_t ROM_ARCHIVE_HEADER_SIZE  = 32;
+const uint32_t ROM_ARCHIVE_ENTRY_SIZE   = 32;
+const uint32_t ROM_ARCHIVE_ALIGNMENT    = 16;
+
+struct ArchivedRom {
+    std::string_view name;
+    uint64_t hash;
+    const uint8_t* data;        // Points into the mapping; valid while the archive is open
+    size_t size;
+};
+
+struct RomToPack {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+
+class RomArchive {
+public:
+    RomArchive() = default;
+    ~RomArchive();
+
+    RomArchive(const RomArchive&) = delete;
+    RomArchive& operator=(const RomArchive&) = delete;
+
+    // Map and validate an archive; false if it cannot be read or is malformed.
+    bool Open(const std::string& path);
+    void Close();
+
+    [[nodiscard]] bool IsOpen() const { return base != nullptr; }
+    [[nodiscard]] size_t Count() const { return count; }
+
+    [[nodiscard]] ArchivedRom At(size_t i) const;                  // In name order
+    [[nodiscard]] bool Find(std::string_view name, ArchivedRom& rom) const;
+
+    // Write an archive holding the given ROMs (any order; they are sorted here).
+    static bool Write(const std::string& path, std::vector<RomToPack> roms);
+
+private:
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    uint32_t indexOffset = 0;
+    uint32_t namesOffset = 0;
+
+    bool mapped = false;                    // mmap'd, as opposed to read into a heap buffer
+    std::vector<uint8_t> fallbackBuffer;
+};
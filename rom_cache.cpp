@@ -0,0 +1,71 @@
+#include "rom_cache.h"
+#include "chip8.h"
+#include "headless.h"
+
+#include <filesystem>
+
+RomCache::~RomCache() {
+    stopLoading.store(true);
+    if (loader.joinable()) loader.join();
+}
+
+
+void RomCache::PreloadAsync(std::string directory, std::vector<std::string> names) {
+    if (loader.joinable()) {
+        stopLoading.store(true);
+        loader.join();
+        stopLoading.store(false);
+    }
+
+    loader = std::thread([this, directory = std::move(directory), names = std::move(names)] {
+        for (const std::string& name : names) {
+            if (stopLoading.load()) return;
+            if (Find(name)) continue;
+
+            std::shared_ptr<const RomImage> image = ReadImage(directory, name);
+            if (!image) continue;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            images.emplace(name, std::move(image));
+        }
+    });
+}
+
+
+std::shared_ptr<const RomImage> RomCache::Find(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = images.find(name);
+    return it != images.end() ? it->second : nullptr;
+}
+
+
+std::shared_ptr<const RomImage> RomCache::Get(const std::string& directory, const std::string& name) {
+    if (auto image = Find(name)) return image;
+
+    std::shared_ptr<const RomImage> image = ReadImage(directory, name);
+    if (!image) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.emplace(name, std::move(image)).first->second;
+}
+
+
+std::shared_ptr<const RomImage> RomCache::ReadImage(const std::string& directory, const std::string& name) {
+    std::filesystem::path path = std::filesystem::path(directory) / name;
+
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || size > MAX_ROM_SIZE) return nullptr;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+
+    auto image = std::make_shared<RomImage>();
+    image->name = name;
+    image->bytes.resize(size);
+    file.read(reinterpret_cast<char*>(image->bytes.data()), static_cast<std::streamsize>(size));
+    if (file.gcount() != static_cast<std::streamsize>(size)) return nullptr;
+
+    image->hash = Fnv1a(image->bytes.data(), image->bytes.size());
+    return image;
+}
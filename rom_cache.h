@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A validated ROM held in memory, ready to be handed to Chip8::LoadROM().
+struct RomImage {
+    std::string name;
+    uint64_t hash{};                // FNV-1a of bytes
+    std::vector<uint8_t> bytes;     // At most MAX_ROM_SIZE
+};
+
+
+// In-memory cache of ROM images, so switching games costs a memcpy into
+// Chip8::memory and a reset, with no file I/O on the UI thread.
+//
+// PreloadAsync() reads a list of ROMs on a background thread; anything it has
+// not reached yet (or that appeared later) is read on first use by Get().
+// Images are immutable and handed out as shared_ptr, so a lookup stays valid
+// even while the loader thread is still adding entries.
+class RomCache {
+public:
+    RomCache() = default;
+    ~RomCache();
+
+    RomCache(const RomCache&) = delete;
+    RomCache& operator=(const RomCache&) = delete;
+
+    void PreloadAsync(std::string directory, std::vector<std::string> names);
+
+    // Cached image, or nullptr if it has not been loaded.
+    [[nodiscard]] std::shared_ptr<const RomImage> Find(const std::string& name) const;
+
+    // Cached image, reading (and caching) the file if needed. nullptr if the
+    // file cannot be read or is too large to be a ROM.
+    std::shared_ptr<const RomImage> Get(const std::string& directory, const std::string& name);
+
+private:
+    mutable std::mutex mutex;               // Guards images
+    std::unordered_map<std::string, std::shared_ptr<const RomImage>> images;
+
+    std::thread loader;
+    std::atomic<bool> stopLoading{false};
+
+    static std::shared_ptr<const RomImage> ReadImage(const std::string& directory, const std::string& name);
+};
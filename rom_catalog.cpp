@@ -0,0 +1,151 @@
+#include "rom_catalog.h"
+#include "chip8.h"
+#include "headless.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+RomCatalog::RomCatalog(std::string directory) : directory(std::move(directory)) {}
+
+RomCatalog::~RomCatalog() {
+    if (scanner.joinable()) scanner.join();
+}
+
+
+void RomCatalog::ScanAsync() {
+    if (scanner.joinable()) scanner.join();
+    ready.store(false, std::memory_order_release);
+    scanner = std::thread(&RomCatalog::Scan, this);
+}
+
+
+std::vector<RomInfo> RomCatalog::Entries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries;
+}
+
+
+void RomCatalog::Scan() {
+    namespace fs = std::filesystem;
+
+    // Previous results, keyed by name
+    std::map<std::string, RomInfo> previous;
+    for (RomInfo& info : LoadIndex()) previous[info.name] = std::move(info);
+
+    std::vector<RomInfo> found;
+    bool changed = false;
+    std::error_code error;
+
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (!entry.is_regular_file(error)) continue;
+
+        RomInfo info;
+        info.name = entry.path().filename().string();
+        if (info.name.rfind(INDEX_FILE_NAME, 0) == 0) continue;   // The index and its temporary file
+
+        info.size = entry.file_size(error);
+        info.modified = entry.last_write_time(error).time_since_epoch().count();
+
+        auto it = previous.find(info.name);
+        if (it != previous.end() && it->second.size == info.size && it->second.modified == info.modified) {
+            found.push_back(it->second);                // Unchanged: reuse without reading the file
+            continue;
+        }
+
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::vector<uint8_t> bytes(info.size);
+        file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+        info.hash = Fnv1a(bytes.data(), bytes.size());
+        info.variant = info.size > MAX_ROM_SIZE ? "too large" : DetectVariant(bytes.data(), bytes.size());
+
+        found.push_back(std::move(info));
+        changed = true;
+    }
+    changed |= found.size() != previous.size();
+
+    std::sort(found.begin(), found.end(), [](const RomInfo& a, const RomInfo& b) { return a.name < b.name; });
+
+    if (changed) SaveIndex(found);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = std::move(found);
+    }
+    ready.store(true, std::memory_order_release);
+}
+
+
+// Parse a whole field as an integer; anything else fails.
+template <typename T>
+static bool ParseField(const std::string& field, T& value, int base = 10) {
+    const char* end = field.data() + field.size();
+    auto [next, error] = std::from_chars(field.data(), end, value, base);
+    return error == std::errc() && next == end;
+}
+
+
+// The index is a tab-separated text file: the INDEX_VERSION line, then one
+// ROM per line: name, size, modified, hash (hex), variant. A missing index,
+// another version or any malformed line is a miss, and Scan() reads every ROM.
+std::vector<RomInfo> RomCatalog::LoadIndex() const {
+    std::vector<RomInfo> index;
+    std::ifstream file(std::filesystem::path(directory) / INDEX_FILE_NAME);
+
+    std::string line;
+    if (!std::getline(file, line) || line != INDEX_VERSION) return {};
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t')) fields.push_back(field);
+        if (fields.size() != 5) return {};
+
+        RomInfo info;
+        info.name = fields[0];
+        info.variant = fields[4];
+        if (!ParseField(fields[1], info.size) || !ParseField(fields[2], info.modified) ||
+            !ParseField(fields[3], info.hash, 16)) return {};
+        index.push_back(std::move(info));
+    }
+    return index;
+}
+
+
+void RomCatalog::SaveIndex(const std::vector<RomInfo>& index) const {
+    // Write to a temporary file and rename, so a crash never leaves a torn index.
+    // A read-only ROM directory just means every startup rescans.
+    std::filesystem::path path = std::filesystem::path(directory) / INDEX_FILE_NAME;
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) return;
+
+        file << INDEX_VERSION << '\n';
+        file << "# CHIP-8 ROM index: name, size, modified, hash, variant\n";
+        for (const RomInfo& info : index) {
+            file << info.name << '\t' << info.size << '\t' << info.modified << '\t'
+                 << std::hex << info.hash << std::dec << '\t' << info.variant << '\n';
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+}
+
+
+// The instruction set, from the quirk profile LoadROM() would pick. The
+// original interpreter and the later CHIP-8 ones share it.
+std::string DetectVariant(const uint8_t* rom, size_t size) {
+    switch (DetectQuirks(rom, size)) {
+        case QuirkProfile::XoChip:      return "XO-CHIP";
+        case QuirkProfile::SuperChip:   return "SCHIP";
+        default:                        return "CHIP-8";
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Everything the frontend needs to know about a ROM without opening it.
+struct RomInfo {
+    std::string name;           // File name inside the catalog directory
+    uint64_t size{};            // Bytes
+    int64_t modified{};         // Last write time, in file clock ticks
+    uint64_t hash{};            // FNV-1a of the contents
+    std::string variant;        // "CHIP-8", "SCHIP", "XO-CHIP" or "too large"
+};
+
+
+// Catalog of the ROMs in a directory, built on a background thread.
+//
+// The results are kept in an index file inside the directory (INDEX_FILE_NAME).
+// On later scans a file whose size and modification time match its index
+// entry is not read again, so startup cost is proportional to what changed
+// rather than to the size of the collection. An index with another version
+// line, or one that does not parse, is ignored and every ROM is read again.
+class RomCatalog {
+public:
+    static constexpr const char* INDEX_FILE_NAME = ".chip8index";
+    static constexpr const char* INDEX_VERSION = "chip8index 2";    // Bump when the index format or DetectVariant() change
+
+    explicit RomCatalog(std::string directory);
+    ~RomCatalog();
+
+    RomCatalog(const RomCatalog&) = delete;
+    RomCatalog& operator=(const RomCatalog&) = delete;
+
+    void ScanAsync();                                   // Start (or restart) the background scan
+    [[nodiscard]] bool Ready() const { return ready.load(std::memory_order_acquire); }
+
+    [[nodiscard]] const std::string& Directory() const { return directory; }
+    [[nodiscard]] std::vector<RomInfo> Entries() const; // Sorted by name; empty until Ready()
+
+private:
+    std::string directory;
+    std::thread scanner;
+    std::atomic<bool> ready{false};
+
+    mutable std::mutex mutex;                           // Guards entries
+    std::vector<RomInfo> entries;
+
+    void Scan();
+    [[nodiscard]] std::vector<RomInfo> LoadIndex() const;
+    void SaveIndex(const std::vector<RomInfo>& index) const;
+};
+
+// Guess the CHIP-8 variant a ROM was written for from the opcodes it contains.
+std::string DetectVariant(const uint8_t* rom, size_t size);
@@ -0,0 +1,102 @@
+#include "rom_profile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+void RomProfile::NoteModified(const Chip8& chip8, const uint8_t* rom, size_t size) {
+    for (unsigned int address = START_INSTRUCTION_ADDRESS; address + 1 < START_INSTRUCTION_ADDRESS + size; ++address) {
+        if (counts[address] == 0) continue;
+        for (unsigned int byte = address; byte < address + 2; ++byte) {
+            if (chip8.Peek(byte) != rom[byte - START_INSTRUCTION_ADDRESS]) modified.set(byte);
+        }
+    }
+}
+
+
+std::vector<uint16_t> RomProfile::Hot(double coverage) const {
+    std::vector<uint16_t> addresses;
+    for (unsigned int address = 0; address < RAM_SIZE; ++address) {
+        if (counts[address] > 0) addresses.push_back(static_cast<uint16_t>(address));
+    }
+    std::stable_sort(addresses.begin(), addresses.end(),
+                     [&](uint16_t a, uint16_t b) { return counts[a] > counts[b]; });
+
+    auto target = static_cast<double>(Instructions()) * coverage;
+    double covered = 0;
+    size_t keep = 0;
+    while (keep < addresses.size() && covered < target) covered += static_cast<double>(counts[addresses[keep++]]);
+    addresses.resize(keep);
+    return addresses;
+}
+
+
+uint64_t RomProfile::Instructions() const {
+    uint64_t total = 0;
+    for (uint64_t count : counts) total += count;
+    return total;
+}
+
+
+// A text file with one record per line:
+//   hash <rom hash>
+//   count <address> <instructions>         (hex address, executed addresses only)
+//   modified <address>
+bool RomProfile::Load(const std::string& path) {
+    *this = RomProfile();
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+
+        if (kind == "hash") {
+            fields >> std::hex >> romHash;
+        } else if (kind == "count") {
+            unsigned int address = 0;
+            uint64_t count = 0;
+            fields >> std::hex >> address >> std::dec >> count;
+            if (fields && address < RAM_SIZE) counts[address] = count;
+        } else if (kind == "modified") {
+            unsigned int address = 0;
+            fields >> std::hex >> address;
+            if (fields && address < RAM_SIZE) modified.set(address);
+        }
+    }
+    return true;
+}
+
+
+bool RomProfile::Save(const std::string& path) const {
+    // Write to a temporary file and rename, like the catalog index
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) return false;
+
+        file << "# CHIP-8 ROM profile\n";
+        file << "hash " << std::hex << romHash << std::dec << '\n';
+        for (unsigned int address = 0; address < RAM_SIZE; ++address) {
+            if (counts[address] > 0) file << "count " << std::hex << address << std::dec << ' ' << counts[address] << '\n';
+        }
+        for (unsigned int address = 0; address < RAM_SIZE; ++address) {
+            if (modified[address]) file << "modified " << std::hex << address << std::dec << '\n';
+        }
+        if (!file) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+
+std::string ProfilePath(const std::string& directory, uint64_t romHash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.prof", static_cast<unsigned long long>(romHash));
+    return (std::filesystem::path(directory) / name).string();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+// What a ROM did when it last ran, kept across sessions so that the next
+// load can prepare for it (a warm start) instead of finding out again.
+//
+//   - counts: instructions executed at each address. The hot addresses are
+//     the ones to have native code for, and any executed address that the
+//     static analysis did not find is a block boundary it could not see
+//     (a Bnnn or 00EE target).
+//   - modified: code bytes that did not match the ROM when they were about
+//     to run, i.e. self-modifying code. Native code for them is useless.
+//
+// CompiledRom::Record() fills a profile in while it runs a machine. Recompile
+// --profile compiles the blocks the profile saw and leaves out the modified
+// ones, hottest first, and CompiledRom::Open() with a profile gets the hot
+// blocks ready before the first frame (see compiled_rom.h).
+//
+// Profiles are small text files named after the FNV-1a hash of the ROM, so a
+// renamed ROM keeps its profile and a changed one starts over.
+
+struct RomProfile {
+    uint64_t romHash{};
+    std::vector<uint64_t> counts = std::vector<uint64_t>(RAM_SIZE);
+    std::bitset<RAM_SIZE> modified;
+
+    // `instructions` executed in sequence from `address`
+    void Count(uint16_t address, uint32_t instructions) {
+        for (uint32_t i = 0; i < instructions; ++i) ++counts[(address + 2 * i) & (RAM_SIZE - 1)];
+    }
+
+    // Executed instruction bytes that the machine's memory no longer holds as
+    // in the ROM. Catches self-modification that happened without passing
+    // through native code (an interpreter-only run).
+    void NoteModified(const Chip8& chip8, const uint8_t* rom, size_t size);
+
+    // Executed addresses, most executed first, until `coverage` of all
+    // executed instructions is accounted for
+    [[nodiscard]] std::vector<uint16_t> Hot(double coverage = 1.0) const;
+
+    [[nodiscard]] uint64_t Instructions() const;
+
+    // False if the file is missing or unreadable; the profile is then empty
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+};
+
+// DIR/<hash in hex>.prof
+std::string ProfilePath(const std::string& directory, uint64_t romHash);
@@ -0,0 +1,63 @@
+#include "state_publisher.h"
+
+#include <cstring>
+#include <thread>
+
+static_assert(std::is_trivially_copyable_v<PublishedState>, "published state is copied word by word");
+
+
+void StatePublisher::Publish(const Chip8& chip8, uint64_t frame) {
+    chip8.ReadMemory(0, scratch.memory, RAM_SIZE);
+    memcpy(scratch.display, chip8.display, sizeof(scratch.display));
+    scratch.hires = chip8.HiRes();
+    memcpy(scratch.stack, chip8.Stack(), sizeof(scratch.stack));
+    memcpy(scratch.V, chip8.Registers(), sizeof(scratch.V));
+    scratch.frame = frame;
+    scratch.pc = chip8.PC();
+    scratch.I = chip8.Index();
+    scratch.sp = chip8.SP();
+    scratch.delayTimer = chip8.DelayTimer();
+    scratch.soundTimer = chip8.SoundTimer();
+    scratch.fault = chip8.LastFault();
+
+    uint64_t count = published.load(std::memory_order_relaxed);
+    Slot& slot = slots[count % 2];
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&scratch);
+    for (size_t i = 0; i < WORDS; ++i) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + 8 * i, std::min<size_t>(8, sizeof(scratch) - 8 * i));
+        slot.words[i].store(word, std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    published.store(count + 1, std::memory_order_release);
+}
+
+
+bool StatePublisher::Read(PublishedState& out) const {
+    uint64_t word[WORDS];
+
+    for (unsigned int attempt = 0;; ++attempt) {
+        uint64_t count = published.load(std::memory_order_acquire);
+        if (count == 0) return false;
+        const Slot& slot = slots[(count - 1) % 2];
+
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before % 2 == 0) {
+            for (size_t i = 0; i < WORDS; ++i) word[i] = slot.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) break;
+        }
+
+        // The writer lapped us; it is running flat out, so let it finish
+        if (attempt >= 16) std::this_thread::yield();
+    }
+
+    memcpy(&out, word, sizeof(out));
+    return true;
+}
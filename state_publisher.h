@@ -0,0 +1,57 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <atomic>
+
+// A consistent copy of a machine for tools that watch it from other threads
+// (a debugger window, a metrics exporter, a RAM search).
+struct PublishedState {
+    uint8_t memory[RAM_SIZE];
+    DisplayRows display;            // Packed as in Chip8, see chip8.h
+    bool hires;
+    uint16_t stack[STACK_LEVELS];
+    uint8_t V[REGISTER_COUNT];
+    uint64_t frame;                 // Whatever the publisher counts, e.g. frames since the ROM was loaded
+    uint16_t pc, I, sp;
+    uint8_t delayTimer, soundTimer;
+    Fault fault;
+};
+
+
+// Publishes machine state from the emulation thread, typically once per
+// frame, for any number of reader threads.
+//
+// The state is a sequence lock over two slots. Publish() writes the older
+// slot, bumping its sequence number before and after, then points readers at
+// it; it never waits for a reader. A reader copies the newest slot and checks
+// that its sequence number did not change meanwhile, retrying if it did,
+// which only happens when two publishes complete during one copy. The slots
+// are arrays of relaxed atomics, so the racing copies are well defined, and
+// they compile to plain loads and stores.
+class StatePublisher {
+public:
+    StatePublisher() = default;
+    StatePublisher(const StatePublisher&) = delete;
+    StatePublisher& operator=(const StatePublisher&) = delete;
+
+    // Emulation thread only
+    void Publish(const Chip8& chip8, uint64_t frame);
+
+    // Any thread. False if nothing has been published yet.
+    bool Read(PublishedState& out) const;
+
+    [[nodiscard]] uint64_t Publications() const { return published.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(PublishedState) + 7) / 8;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{};           // Odd while being written
+        std::atomic<uint64_t> words[WORDS]{};
+    };
+
+    Slot slots[2];
+    std::atomic<uint64_t> published{};              // Publishes so far; the newest is in slot (published - 1) % 2
+    PublishedState scratch{};                       // Gathered here first, then stored into a slot
+};
@@ -0,0 +1,149 @@
+#include "time_travel.h"
+#include "headless.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Bounds for the checkpoint interval. Below the lower one, checkpoints would
+// cost more than the replays they save.
+const uint32_t MIN_CHECKPOINT_INTERVAL  = 256;
+const uint32_t MAX_CHECKPOINT_INTERVAL  = 1u << 22;
+
+
+TimeTravel::TimeTravel(Chip8& chip8, double reverseBudget, size_t maxCheckpoints)
+    : chip8(chip8), reverseBudget(reverseBudget), maxCheckpoints(std::max<size_t>(maxCheckpoints, 4)),
+      interval(4096) {}
+
+
+void TimeTravel::Start() {
+    cycle = newest = 0;
+    checkpoints.clear();
+    keyLog.clear();
+    checkpoints.push_back({0, chip8.SaveState()});
+    keyLog.push_back({0, HeldKeys()});
+}
+
+
+uint16_t TimeTravel::HeldKeys() const {
+    uint16_t keys = 0;
+    for (unsigned int k = 0; k < KEY_COUNT; ++k) keys |= (chip8.key[k] != 0) << k;
+    return keys;
+}
+
+
+uint16_t TimeTravel::KeysAt(uint64_t at) const {
+    auto after = std::upper_bound(keyLog.begin(), keyLog.end(), at,
+                                  [](uint64_t value, const KeyChange& change) { return value < change.cycle; });
+    return std::prev(after)->keys;
+}
+
+
+// About to execute instruction `cycle`: note the keys if they changed, and
+// take a checkpoint if it is time for one.
+void TimeTravel::Record() {
+    if (checkpoints.empty()) Start();
+
+    uint16_t keys = HeldKeys();
+    if (cycle < newest && keys != KeysAt(cycle)) Truncate();
+
+    if (cycle == newest) {
+        if (keys != keyLog.back().keys) {
+            if (keyLog.back().cycle == cycle) keyLog.back().keys = keys;
+            else keyLog.push_back({cycle, keys});
+        }
+        if (cycle - checkpoints.back().cycle >= interval) {
+            checkpoints.push_back({cycle, chip8.SaveState()});
+            if (checkpoints.size() > maxCheckpoints) Thin();
+        }
+    }
+}
+
+
+// The past is being rewritten: drop what was recorded after this point.
+void TimeTravel::Truncate() {
+    while (checkpoints.back().cycle > cycle) checkpoints.pop_back();
+    while (keyLog.size() > 1 && keyLog.back().cycle >= cycle) keyLog.pop_back();
+    newest = cycle;
+}
+
+
+// Drop every other checkpoint of the older half, keeping the first
+void TimeTravel::Thin() {
+    size_t half = checkpoints.size() / 2;
+    size_t kept = 1;
+    for (size_t i = 1; i < checkpoints.size(); ++i) {
+        if (i < half && i % 2 == 1) continue;
+        if (kept != i) checkpoints[kept] = std::move(checkpoints[i]);
+        ++kept;
+    }
+    checkpoints.resize(kept);
+}
+
+
+Fault TimeTravel::Step() {
+    Record();
+    Fault fault = chip8.Cycle();
+    if (fault == Fault::None) {
+        ++cycle;
+        newest = std::max(newest, cycle);
+    }
+    return fault;
+}
+
+
+Fault TimeTravel::Run(uint32_t count, uint32_t* executed) {
+    uint32_t done = 0;
+    Fault fault = Fault::None;
+    while (done < count && (fault = Step()) == Fault::None) ++done;
+    if (executed) *executed = done;
+    return fault;
+}
+
+
+bool TimeTravel::StepBack() {
+    return cycle > 0 && Seek(cycle - 1);
+}
+
+
+bool TimeTravel::Seek(uint64_t target) {
+    if (checkpoints.empty() || target > newest) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto checkpoint = std::prev(std::upper_bound(
+            checkpoints.begin(), checkpoints.end(), target,
+            [](uint64_t value, const Checkpoint& c) { return value < c.cycle; }));
+    chip8.LoadState(checkpoint->state);
+    cycle = checkpoint->cycle;
+
+    // Replay in runs of constant keys
+    auto change = std::upper_bound(keyLog.begin(), keyLog.end(), cycle,
+                                   [](uint64_t value, const KeyChange& c) { return value < c.cycle; });
+    while (cycle < target) {
+        ApplyKeys(chip8, std::prev(change)->keys);
+        uint64_t until = change != keyLog.end() ? std::min(target, change->cycle) : target;
+        uint32_t executed;
+        Fault fault = chip8.RunCycles(static_cast<uint32_t>(std::min<uint64_t>(until - cycle, UINT32_MAX)), &executed);
+        cycle += executed;
+        if (IsDebugStop(fault)) {
+            // Breakpoints are for the debugger's user, not for replays
+            chip8.Resume();
+            continue;
+        }
+        if (fault != Fault::None) break;    // Cannot happen in a faithful replay, but never spin
+        if (cycle == until && change != keyLog.end() && change->cycle == cycle) ++change;
+    }
+    ApplyKeys(chip8, KeysAt(target));
+
+    // Space the checkpoints so that a replay of a whole interval fits in
+    // half the budget; LoadState() and the variation in speed get the rest.
+    uint64_t replayed = target - checkpoint->cycle;
+    if (replayed >= MIN_CHECKPOINT_INTERVAL) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double sample = seconds / static_cast<double>(replayed);
+        secondsPerCycle = secondsPerCycle == 0 ? sample : 0.75 * secondsPerCycle + 0.25 * sample;
+        double fits = 0.5 * reverseBudget / secondsPerCycle;
+        interval = static_cast<uint32_t>(std::clamp<double>(fits, MIN_CHECKPOINT_INTERVAL, MAX_CHECKPOINT_INTERVAL));
+    }
+    return true;
+}
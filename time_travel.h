@@ -0,0 +1,85 @@
+#pragma once
+
+#include "chip8.h"
+
+#include <vector>
+
+// Reverse execution for a debugger. Every instruction run through Step() is
+// numbered; going back to instruction n loads the last checkpoint at or
+// before n and re-executes from there with the keys that were held at the
+// time. The core is deterministic given its state (the RNG position is part
+// of a MachineState) and its keys, so the replay ends in exactly the state
+// the machine was in.
+//
+// Checkpoints are taken every Interval() instructions. The interval adapts to
+// the measured replay speed so that going back one instruction takes at most
+// about `reverseBudget` seconds. Once there are more than `maxCheckpoints`, the
+// older half of them is thinned out: stepping back stays fast, seeking far
+// into the past gets slower.
+//
+//   TimeTravel history(chip8);
+//   history.Start();
+//   history.Run(1000);
+//   history.StepBack();         // Now at instruction 999
+//
+// Instructions that did not go through Step() or Run() (a Cycle() called on
+// the machine directly) are invisible to the history; call Start() again
+// after one, and after loading a ROM.
+const double DEFAULT_REVERSE_BUDGET     = 0.001;
+const size_t DEFAULT_MAX_CHECKPOINTS    = 4096;
+
+
+class TimeTravel {
+public:
+    explicit TimeTravel(Chip8& chip8, double reverseBudget = DEFAULT_REVERSE_BUDGET,
+                        size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS);
+
+    // Forget the history; the machine as it is now becomes instruction 0
+    void Start();
+
+    // Execute forward, recording. Stepping forward from a point in the past
+    // keeps the history ahead of it as long as the keys held are the ones
+    // that were held the first time, and drops it otherwise.
+    Fault Step();
+    Fault Run(uint32_t count, uint32_t* executed = nullptr);
+
+    // Go back one instruction; false at instruction 0
+    bool StepBack();
+
+    // Go to any instruction from 0 to Newest(), replaying the recorded keys.
+    // The machine's keys are set to the ones held at `target`.
+    bool Seek(uint64_t target);
+
+    [[nodiscard]] uint64_t Cycle() const { return cycle; }          // Instructions executed since Start()
+    [[nodiscard]] uint64_t Newest() const { return newest; }        // Furthest instruction recorded
+    [[nodiscard]] uint32_t Interval() const { return interval; }
+    [[nodiscard]] size_t Checkpoints() const { return checkpoints.size(); }
+
+private:
+    struct Checkpoint {
+        uint64_t cycle;
+        MachineState state;
+    };
+
+    struct KeyChange {
+        uint64_t cycle;         // The keys are held from this instruction on
+        uint16_t keys;
+    };
+
+    Chip8& chip8;
+    double reverseBudget;
+    size_t maxCheckpoints;
+
+    std::vector<Checkpoint> checkpoints;        // Sorted by cycle; the first is at 0
+    std::vector<KeyChange> keyLog;              // Sorted by cycle; the first is at 0
+    uint64_t cycle{};
+    uint64_t newest{};
+    uint32_t interval;
+    double secondsPerCycle{};                   // Replay speed, averaged over the seeks so far
+
+    void Record();
+    void Truncate();
+    void Thin();
+    [[nodiscard]] uint16_t KeysAt(uint64_t at) const;
+    [[nodiscard]] uint16_t HeldKeys() const;
+};
@@ -0,0 +1,237 @@
+// Interactive RAM search over many instances of one ROM (see ram_search.h),
+// for finding score and lives addresses and turning them into cheats or
+// VectorEnv reward probes.
+//
+//   CheatFinder --rom FILE [--instances N] [--threads N] [--seed N]
+//
+// Commands are read from stdin, one per line:
+//
+//   run FRAMES [KEYS]     Run every instance; KEYS (hex mask) is held in all of
+//                         them, otherwise each one gets its own random input
+//   new                   Start a new search: every address is a candidate
+//   filter REL [VALUE]    eq ne gt lt (VALUE), changed same inc dec, inc-by dec-by (VALUE)
+//   list [N]              Show up to N candidates and their values
+//   freeze ADDR VALUE [NAME]
+//   unfreeze ADDR
+//   save FILE             Write the frozen values as a cheat file
+//   load FILE             Freeze the values in a cheat file
+//   restart               Reload the ROM in every instance
+//   quit
+//
+// Values and addresses are hex. Frozen values are written into every instance
+// once per frame.
+
+#include "headless.h"
+#include "ram_search.h"
+
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <thread>
+
+
+class CheatFinder {
+public:
+    CheatFinder(std::vector<uint8_t> rom, size_t instances, unsigned int threads, uint32_t seed)
+        : rom(std::move(rom)), machines(instances, Chip8(16)), inputs(instances), threads(threads), seed(seed) {}
+
+    bool Restart();
+    void Run(uint32_t frames, int keys);
+    void NewSearch();
+    void Filter(SearchRelation relation, uint8_t operand);
+    void List(size_t limit) const;
+    void Freeze(uint16_t address, uint8_t value, const std::string& name);
+    void Unfreeze(uint16_t address);
+    void Save(const std::string& path) const;
+    void Load(const std::string& path);
+
+private:
+    std::vector<uint8_t> rom;
+    std::vector<Chip8> machines;
+    std::vector<std::mt19937> inputs;       // Random input per instance
+    unsigned int threads;
+    uint32_t seed;
+
+    RamSearch search;
+    std::vector<Cheat> cheats;
+
+    std::vector<const Chip8*> MachinePointers() const {
+        std::vector<const Chip8*> pointers;
+        for (const Chip8& machine : machines) pointers.push_back(&machine);
+        return pointers;
+    }
+};
+
+
+bool CheatFinder::Restart() {
+    for (size_t i = 0; i < machines.size(); ++i) {
+        if (!machines[i].LoadROM(rom.data(), rom.size())) return false;
+        machines[i].Seed(seed + static_cast<uint32_t>(i));
+        inputs[i].seed(seed + static_cast<uint32_t>(i));
+    }
+    return true;
+}
+
+
+void CheatFinder::Run(uint32_t frames, int keys) {
+    auto runSlice = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint16_t held = 0;
+            for (uint32_t frame = 0; frame < frames; ++frame) {
+                // Random input changes every 8 frames: one key, or none
+                if (keys >= 0) held = static_cast<uint16_t>(keys);
+                else if (frame % 8 == 0) held = inputs[i]() % 3 == 0 ? 0 : 1 << (inputs[i]() % KEY_COUNT);
+
+                ApplyKeys(machines[i], held);
+                ApplyCheats(machines[i], cheats);
+                machines[i].RunCycles(CYCLES_PER_FRAME);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t count = machines.size();
+    for (unsigned int t = 1; t < threads; ++t) workers.emplace_back(runSlice, count * t / threads, count * (t + 1) / threads);
+    runSlice(0, count / threads);
+    for (std::thread& worker : workers) worker.join();
+}
+
+
+void CheatFinder::NewSearch() {
+    std::vector<const Chip8*> pointers = MachinePointers();
+    search.Reset(pointers.data(), pointers.size());
+    std::cout << search.Count() << " candidates" << std::endl;
+}
+
+
+void CheatFinder::Filter(SearchRelation relation, uint8_t operand) {
+    if (search.Instances() != machines.size()) NewSearch();
+
+    std::vector<const Chip8*> pointers = MachinePointers();
+    auto start = std::chrono::steady_clock::now();
+    size_t left = search.Filter(pointers.data(), relation, operand);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    char line[80];
+    snprintf(line, sizeof(line), "%zu candidates (%.0f us over %zu instances)", left, us, machines.size());
+    std::cout << line << std::endl;
+}
+
+
+void CheatFinder::List(size_t limit) const {
+    std::vector<uint16_t> addresses = search.Candidates();
+    size_t shown = std::min(limit, addresses.size());
+    size_t columns = std::min<size_t>(search.Instances(), 8);
+
+    char text[16];
+    for (size_t a = 0; a < shown; ++a) {
+        snprintf(text, sizeof(text), "%03X:", addresses[a]);
+        std::cout << text;
+        for (size_t i = 0; i < columns; ++i) {
+            snprintf(text, sizeof(text), " %02X", search.Value(i, addresses[a]));
+            std::cout << text;
+        }
+        std::cout << "\n";
+    }
+    if (shown < addresses.size()) std::cout << "... " << addresses.size() - shown << " more\n";
+    std::cout << std::flush;
+}
+
+
+void CheatFinder::Freeze(uint16_t address, uint8_t value, const std::string& name) {
+    Unfreeze(address);
+    cheats.push_back({static_cast<uint16_t>(address & (RAM_SIZE - 1)), value, name});
+}
+
+
+void CheatFinder::Unfreeze(uint16_t address) {
+    std::erase_if(cheats, [&](const Cheat& cheat) { return cheat.address == (address & (RAM_SIZE - 1)); });
+}
+
+
+void CheatFinder::Save(const std::string& path) const {
+    if (SaveCheats(path, cheats, "written by CheatFinder")) std::cout << cheats.size() << " cheats saved" << std::endl;
+    else std::cerr << "Cannot write " << path << std::endl;
+}
+
+
+void CheatFinder::Load(const std::string& path) {
+    std::vector<Cheat> loaded;
+    if (!LoadCheats(path, loaded)) {
+        std::cerr << "Cannot read " << path << std::endl;
+        return;
+    }
+    for (const Cheat& cheat : loaded) Freeze(cheat.address, cheat.value, cheat.name);
+    std::cout << loaded.size() << " cheats loaded" << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string romPath;
+    size_t instances = 16;
+    unsigned int threads = 1;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rom" && hasValue) romPath = argv[++i];
+        else if (arg == "--instances" && hasValue) instances = std::stoul(argv[++i]);
+        else if (arg == "--threads" && hasValue) threads = std::stoul(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = std::stoul(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " --rom FILE [--instances N] [--threads N] [--seed N]" << std::endl;
+            return 2;
+        }
+    }
+    if (romPath.empty() || instances == 0 || threads == 0) {
+        std::cerr << "Usage: " << argv[0] << " --rom FILE [--instances N] [--threads N] [--seed N]" << std::endl;
+        return 2;
+    }
+
+    std::ifstream file(romPath, std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CheatFinder finder(std::move(rom), instances, std::min<unsigned int>(threads, instances), seed);
+    if (!file.is_open() || !finder.Restart()) {
+        std::cerr << "Cannot load ROM " << romPath << std::endl;
+        return 2;
+    }
+    finder.NewSearch();
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream fields(line);
+        std::string command;
+        if (!(fields >> command)) continue;
+
+        try {
+            std::string a, b, rest;
+            fields >> a >> b;
+            std::getline(fields >> std::ws, rest);
+
+            if (command == "quit") break;
+            else if (command == "run") finder.Run(std::stoul(a), b.empty() ? -1 : static_cast<int>(std::stoul(b, nullptr, 16)));
+            else if (command == "new") finder.NewSearch();
+            else if (command == "list") finder.List(a.empty() ? 20 : std::stoul(a));
+            else if (command == "freeze") finder.Freeze(std::stoul(a, nullptr, 16), std::stoul(b, nullptr, 16), rest);
+            else if (command == "unfreeze") finder.Unfreeze(std::stoul(a, nullptr, 16));
+            else if (command == "save") finder.Save(a);
+            else if (command == "load") finder.Load(a);
+            else if (command == "restart") finder.Restart();
+            else if (command == "filter") {
+                SearchRelation relation;
+                if (!ParseRelation(a, relation)) {
+                    std::cerr << "Unknown relation " << a << std::endl;
+                    continue;
+                }
+                finder.Filter(relation, b.empty() ? 0 : std::stoul(b, nullptr, 16));
+            } else {
+                std::cerr << "Unknown command " << command << std::endl;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Bad arguments: " << line << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,396 @@
+// Behaviour checks for the core that StressGen's generated programs cannot
+// express: fault handling, static analysis and quirk detection, the
+// SUPER-CHIP display and registers, cross-thread state publishing, the RAM
+// search kernels and the like. Each
+// check builds its own tiny ROM or fixture and compares the outcome with what
+// is written down here.
+//
+//   CoreCheck
+//
+// Prints one PASS/FAIL line per check, in the format of StressGen --verify,
+// and exits with 1 if any failed. ctest runs it (see CMakeLists.txt).
+
+#include "disassembler.h"
+#include "headless.h"
+#include "rom_analysis.h"
+#include "ram_search.h"
+#include "state_publisher.h"
+
+#include <atomic>
+#include <functional>
+#include <random>
+#include <thread>
+
+
+// Print the result of one check; `mismatches` lists what differed.
+static bool Report(const std::string& name, const std::vector<std::string>& mismatches) {
+    std::cout << (mismatches.empty() ? "  PASS  " : "  FAIL  ") << name;
+    for (const std::string& m : mismatches) std::cout << ' ' << m;
+    std::cout << std::endl;
+    return mismatches.empty();
+}
+
+
+// The analysis decodes through the core's dispatch tables, which are filled
+// on first use. Run before anything constructs a Chip8, it must still see
+// 0123 as invalid and stop the block there, rather than reading empty tables.
+static bool CheckAnalysisBeforeMachine() {
+    const uint8_t rom[] = {0x60, 0x01,      // LD V0, 1
+                           0x01, 0x23,      // Invalid
+                           0xFF, 0xFF,
+                           0x12, 0x00};     // JP 0x200
+    RomAnalysis analysis = AnalyzeRom(rom, sizeof(rom), QuirkProfile::Modern);
+
+    std::vector<std::string> mismatches;
+    if (analysis.blocks.size() != 1) {
+        mismatches.push_back("blocks=" + std::to_string(analysis.blocks.size()));
+    } else {
+        const BasicBlock& block = analysis.blocks[0];
+        if (block.end != 0x204) mismatches.emplace_back("end");
+        if (block.exit != BlockExit::Invalid) mismatches.emplace_back("exit");
+    }
+    return Report("analysis before any machine", mismatches);
+}
+
+
+// Fx55 then Fx65 on the same I only makes sense if I moved past the
+// registers in between, so such a ROM runs as vip, and its analysis follows
+// I the way that interpreter moves it. Loading, changing and storing back is
+// the opposite idiom, and stays modern.
+static bool CheckIndexStepping() {
+    const uint8_t storeLoad[] = {0xA3, 0x00,    // LD I, 0x300
+                                 0xF1, 0x55,    // LD [I], V1
+                                 0xF1, 0x65,    // LD V1, [I]
+                                 0x12, 0x06};   // JP 0x206
+    const uint8_t loadStore[] = {0xA3, 0x00,    // LD I, 0x300
+                                 0xF1, 0x65,    // LD V1, [I]
+                                 0x70, 0x01,    // ADD V0, 1
+                                 0xF1, 0x55,    // LD [I], V1
+                                 0x12, 0x08};   // JP 0x208
+
+    std::vector<std::string> mismatches;
+    if (DetectQuirks(storeLoad, sizeof(storeLoad)) != QuirkProfile::CosmacVip) mismatches.emplace_back("store-load");
+    if (DetectQuirks(loadStore, sizeof(loadStore)) != QuirkProfile::Modern) mismatches.emplace_back("load-store");
+
+    // The store covers 300-301 either way; the load reads it back, or the two bytes after it
+    auto flagsAt = [](const RomAnalysis& analysis, uint8_t flag) {
+        std::string marked;
+        for (uint16_t address = 0x300; address < 0x304; ++address) marked += (analysis.flags[address] & flag) ? '1' : '0';
+        return marked;
+    };
+    RomAnalysis vip = AnalyzeRom(storeLoad, sizeof(storeLoad), QuirkProfile::CosmacVip);
+    RomAnalysis modern = AnalyzeRom(storeLoad, sizeof(storeLoad), QuirkProfile::Modern);
+    if (flagsAt(vip, BYTE_WRITTEN) != "1100") mismatches.emplace_back("vip written");
+    if (flagsAt(vip, BYTE_DATA) != "0011") mismatches.emplace_back("vip data");
+    if (flagsAt(modern, BYTE_WRITTEN) != "1100") mismatches.emplace_back("modern written");
+    if (flagsAt(modern, BYTE_DATA) != "1100") mismatches.emplace_back("modern data");
+    return Report("index stepping", mismatches);
+}
+
+
+// A machine that faults stops on the faulting instruction and stays stopped:
+// RunCycles() counts only the instruction before it, then nothing at all.
+static bool CheckFaulted() {
+    const uint8_t rom[] = {0x60, 0x01,      // LD V0, 1
+                           0xFF, 0xFF};     // Invalid
+    Chip8 chip8;
+    chip8.LoadROM(rom, sizeof(rom));
+
+    std::vector<std::string> mismatches;
+    uint32_t executed = 0;
+    if (chip8.RunCycles(10, &executed) != Fault::InvalidOpcode) mismatches.emplace_back("fault");
+    if (executed != 1) mismatches.emplace_back("executed=" + std::to_string(executed));
+    if (chip8.PC() != START_INSTRUCTION_ADDRESS + 2) mismatches.emplace_back("pc");
+
+    executed = 1;
+    if (chip8.RunCycles(10, &executed) != Fault::InvalidOpcode) mismatches.emplace_back("refault");
+    if (executed != 0) mismatches.emplace_back("rerun executed=" + std::to_string(executed));
+    return Report("faulted", mismatches);
+}
+
+
+// Run a SUPER-CHIP ROM that ends in a jump to itself
+static Chip8 RunSuperChip(const std::vector<uint8_t>& rom) {
+    Chip8 chip8;
+    chip8.SetQuirks(QuirkProfile::SuperChip);
+    chip8.LoadROM(rom.data(), rom.size());
+    chip8.RunCycles(100);
+    return chip8;
+}
+
+
+// The 16x16 sprites and the scrolls, against a pixel-by-pixel model. Each
+// case draws one 16x16 sprite with Dxy0, optionally runs one scroll, and
+// expects the display to hold just that sprite at the given position,
+// clipped to the screen. Scrolls move by pixels of the current resolution.
+static bool CheckSuperChipDisplay() {
+    const uint16_t nop = 0x6200;            // LD V2, 0
+    const struct {
+        const char* name;
+        bool hires;
+        uint8_t x, y;
+        uint16_t scroll;
+        int expectedX, expectedY;
+    } cases[] = {
+        {"Dxy0",            true,  60,  10, nop,    60,  10},
+        {"Dxy0-clipped",    true,  120, 56, nop,    120, 56},
+        {"Dxy0-lores",      false, 56,  24, nop,    56,  24},
+        {"00C3",            true,  60,  10, 0x00C3, 60,  13},
+        {"00C4-clipped",    true,  0,   56, 0x00C4, 0,   60},
+        {"00C2-lores",      false, 20,  5,  0x00C2, 20,  7},
+        {"00FB",            true,  60,  10, 0x00FB, 64,  10},
+        {"00FB-clipped",    true,  120, 0,  0x00FB, 124, 0},
+        {"00FB-lores",      false, 50,  5,  0x00FB, 54,  5},
+        {"00FC",            true,  66,  10, 0x00FC, 62,  10},
+        {"00FC-clipped",    true,  0,   0,  0x00FC, -4,  0},
+        {"00FC-lores",      false, 2,   5,  0x00FC, -2,  5},
+    };
+
+    // Different in every row and not symmetric either way, so that flips
+    // and off-by-one shifts show
+    uint16_t sprite[16];
+    for (unsigned int r = 0; r < 16; ++r) sprite[r] = static_cast<uint16_t>(0xF0F0 >> (r % 8) | r);
+
+    std::vector<std::string> mismatches;
+    for (const auto& c : cases) {
+        std::vector<uint8_t> rom;
+        auto emit = [&](uint16_t op) {
+            rom.push_back(static_cast<uint8_t>(op >> 8));
+            rom.push_back(static_cast<uint8_t>(op));
+        };
+        emit(c.hires ? 0x00FF : nop);
+        emit(0xA210);                       // LD I, 0x210
+        emit(0x6000 | c.x);
+        emit(0x6100 | c.y);
+        emit(0xD010);                       // DRW V0, V1, 0
+        emit(c.scroll);
+        emit(0x120C);                       // JP 0x20C
+        emit(0x0000);
+        for (uint16_t row : sprite) emit(row);
+
+        Chip8 chip8 = RunSuperChip(rom);
+        const int width = c.hires ? HIRES_WIDTH : LORES_WIDTH, height = c.hires ? HIRES_HEIGHT : LORES_HEIGHT;
+        unsigned int wrong = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int row = y - c.expectedY, column = x - c.expectedX;
+                bool inside = row >= 0 && row < 16 && column >= 0 && column < 16;
+                bool expected = inside && (sprite[row] >> (15 - column) & 1);
+                if (chip8.Pixel(x, y) != expected) ++wrong;
+            }
+        }
+
+        std::string name = c.name;
+        if (chip8.LastFault() != Fault::None) mismatches.push_back(name + ":" + FaultName(chip8.LastFault()));
+        if (chip8.HiRes() != c.hires) mismatches.push_back(name + ":resolution");
+        if (chip8.Registers()[0xF] != 0) mismatches.push_back(name + ":VF");
+        if (wrong != 0) mismatches.push_back(name + ":" + std::to_string(wrong) + "px");
+    }
+    return Report("super-chip display", mismatches);
+}
+
+
+// Fx30 points I at the big digit, which Dxyn then draws 8x10; Fx75/Fx85
+// save and restore registers through the RPL flags, leaving the others alone.
+static bool CheckSuperChipRegisters() {
+    std::vector<std::string> mismatches;
+
+    const uint8_t bigDigit[] = {0x60, 0x08,     // LD V0, 8
+                                0xF0, 0x30,     // LD HF, V0
+                                0x61, 0x00,     // LD V1, 0
+                                0xD1, 0x1A,     // DRW V1, V1, 10
+                                0x12, 0x08};    // JP 0x208
+    const uint8_t eight[10] = {0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF};
+    Chip8 chip8 = RunSuperChip({std::begin(bigDigit), std::end(bigDigit)});
+    if (chip8.Index() != START_BIG_FONT_ADDRESS + 8 * 10) mismatches.emplace_back("Fx30:I");
+    for (unsigned int y = 0; y < LORES_HEIGHT; ++y) {
+        for (unsigned int x = 0; x < LORES_WIDTH; ++x) {
+            bool expected = y < 10 && x < 8 && (eight[y] >> (7 - x) & 1);
+            if (chip8.Pixel(x, y) != expected) {
+                mismatches.emplace_back("Fx30:pixels");
+                y = LORES_HEIGHT;
+                break;
+            }
+        }
+    }
+
+    std::vector<uint8_t> flags;
+    for (uint8_t r = 0; r < 8; ++r) {
+        flags.insert(flags.end(), {static_cast<uint8_t>(0x60 | r), static_cast<uint8_t>(0x11 * (r + 1))});
+    }
+    flags.insert(flags.end(), {0xF7, 0x75});                    // LD R, V7
+    for (uint8_t r = 0; r < 8; ++r) flags.insert(flags.end(), {static_cast<uint8_t>(0x60 | r), 0x00});
+    flags.insert(flags.end(), {0xF3, 0x85,                      // LD V3, R
+                               0x12, 0x24});                    // JP 0x224
+    chip8 = RunSuperChip(flags);
+    for (unsigned int r = 0; r < 8; ++r) {
+        uint8_t expected = r <= 3 ? static_cast<uint8_t>(0x11 * (r + 1)) : 0;
+        if (chip8.Registers()[r] != expected) mismatches.push_back("Fx75/Fx85:V" + std::to_string(r));
+    }
+    if (chip8.PC() != 0x224) mismatches.emplace_back("Fx75/Fx85:pc");
+    return Report("super-chip registers", mismatches);
+}
+
+
+// Readers of a StatePublisher never see a torn state. The writer fills all of
+// memory with the low byte of the frame number before each publish, so any
+// mix of two publications shows up as a memory byte that disagrees with the
+// frame, while reader threads copy the state as fast as they can.
+static bool CheckPublisherTearing() {
+    const uint64_t publications = 20000;
+    const unsigned int readerCount = 3;
+
+    Chip8 chip8;
+    StatePublisher publisher;
+    std::atomic<bool> writing{true};
+    std::atomic<uint64_t> reads{}, torn{}, backwards{};
+
+    std::vector<std::thread> readers;
+    for (unsigned int r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&] {
+            PublishedState state{};
+            uint64_t lastFrame = 0;
+            while (writing.load(std::memory_order_acquire)) {
+                if (!publisher.Read(state)) continue;
+                reads.fetch_add(1, std::memory_order_relaxed);
+                for (uint8_t byte : state.memory) {
+                    if (byte != static_cast<uint8_t>(state.frame)) {
+                        torn.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                if (state.frame < lastFrame) backwards.fetch_add(1, std::memory_order_relaxed);
+                lastFrame = state.frame;
+            }
+        });
+    }
+
+    for (uint64_t frame = 1; frame <= publications; ++frame) {
+        for (uint16_t address = 0; address < RAM_SIZE; ++address) chip8.Poke(address, static_cast<uint8_t>(frame));
+        publisher.Publish(chip8, frame);
+    }
+    writing.store(false, std::memory_order_release);
+    for (std::thread& reader : readers) reader.join();
+
+    std::vector<std::string> mismatches;
+    if (publisher.Publications() != publications) mismatches.emplace_back("publications");
+    if (reads == 0) mismatches.emplace_back("no reads");
+    if (torn != 0) mismatches.push_back("torn=" + std::to_string(torn));
+    if (backwards != 0) mismatches.push_back("backwards=" + std::to_string(backwards));
+    return Report("publisher (" + std::to_string(reads) + " reads)", mismatches);
+}
+
+
+// Bnnn names the register it adds in the profile it is disassembled for.
+static bool CheckDisassembly() {
+    const struct {
+        uint16_t opcode;
+        QuirkProfile profile;
+        const char* text;
+    } cases[] = {
+        {0xB123, QuirkProfile::Modern,    "JP V0, 0x123"},
+        {0xB123, QuirkProfile::CosmacVip, "JP V0, 0x123"},
+        {0xB123, QuirkProfile::SuperChip, "JP V1, 0x123"},
+    };
+
+    std::vector<std::string> mismatches;
+    char text[DISASSEMBLY_LENGTH];
+    for (const auto& c : cases) {
+        Disassemble(c.opcode, c.profile, text, sizeof(text));
+        if (std::string(text) != c.text) mismatches.push_back(std::string(QuirkProfileName(c.profile)) + ": " + text);
+    }
+    return Report("disassembly", mismatches);
+}
+
+
+// RamSearch's vector compares agree with the relations evaluated one byte at
+// a time. Memory is random but drawn from a few values around a base and
+// around base + 0x80, so that the equal, off-by-one, wrapping and signed vs.
+// unsigned cases all come up. The machines are re-randomized before every
+// filter and the search restarts every few.
+static bool CheckRamSearch() {
+    const unsigned int instanceCount = 3, rounds = 400;
+    const SearchRelation relations[] = {
+        SearchRelation::Equal,      SearchRelation::NotEqual,   SearchRelation::Greater,
+        SearchRelation::Less,       SearchRelation::Changed,    SearchRelation::Unchanged,
+        SearchRelation::Increased,  SearchRelation::Decreased,  SearchRelation::IncreasedBy,
+        SearchRelation::DecreasedBy
+    };
+    auto holds = [](SearchRelation relation, uint8_t now, uint8_t before, uint8_t operand) {
+        switch (relation) {
+            case SearchRelation::Equal:         return now == operand;
+            case SearchRelation::NotEqual:      return now != operand;
+            case SearchRelation::Greater:       return now > operand;
+            case SearchRelation::Less:          return now < operand;
+            case SearchRelation::Changed:       return now != before;
+            case SearchRelation::Unchanged:     return now == before;
+            case SearchRelation::Increased:     return now > before;
+            case SearchRelation::Decreased:     return now < before;
+            case SearchRelation::IncreasedBy:   return now == static_cast<uint8_t>(before + operand);
+            case SearchRelation::DecreasedBy:   return now == static_cast<uint8_t>(before - operand);
+        }
+        return false;
+    };
+
+    std::mt19937 random(44);
+    std::vector<Chip8> machines(instanceCount, Chip8(16));
+    std::vector<const Chip8*> pointers;
+    for (const Chip8& machine : machines) pointers.push_back(&machine);
+
+    auto randomize = [&] {
+        uint8_t base = static_cast<uint8_t>(random());
+        for (Chip8& machine : machines) {
+            for (uint16_t address = 0; address < RAM_SIZE; ++address) {
+                machine.Poke(address, static_cast<uint8_t>(base + random() % 4 - (random() % 2 ? 0 : 0x80)));
+            }
+        }
+    };
+
+    RamSearch search;
+    std::vector<bool> expected(RAM_SIZE);
+    std::vector<std::string> mismatches;
+    for (unsigned int round = 0; round < rounds && mismatches.empty(); ++round) {
+        if (round % 8 == 0) {
+            randomize();
+            search.Reset(pointers.data(), pointers.size());
+            expected.assign(RAM_SIZE, true);
+        }
+
+        std::vector<uint8_t> before(instanceCount * RAM_SIZE);
+        for (unsigned int i = 0; i < instanceCount; ++i) {
+            machines[i].ReadMemory(0, &before[i * RAM_SIZE], RAM_SIZE);
+        }
+        randomize();
+
+        SearchRelation relation = relations[random() % std::size(relations)];
+        auto operand = static_cast<uint8_t>(random() % 2 ? random() % 4 : before[random() % before.size()]);
+        search.Filter(pointers.data(), relation, operand);
+
+        for (uint16_t address = 0; address < RAM_SIZE; ++address) {
+            for (unsigned int i = 0; i < instanceCount; ++i) {
+                uint8_t now = machines[i].Peek(address);
+                if (!holds(relation, now, before[i * RAM_SIZE + address], operand)) expected[address] = false;
+            }
+        }
+
+        std::vector<uint16_t> candidates = search.Candidates();
+        std::vector<uint16_t> wanted;
+        for (uint16_t address = 0; address < RAM_SIZE; ++address) {
+            if (expected[address]) wanted.push_back(address);
+        }
+        if (candidates != wanted) mismatches.push_back("round " + std::to_string(round));
+    }
+    return Report("ram search", mismatches);
+}
+
+
+int main() {
+    // The analysis check comes first: it is about running before any Chip8 exists
+    std::vector<std::function<bool()>> checks = {CheckAnalysisBeforeMachine, CheckIndexStepping, CheckFaulted,
+                                                 CheckSuperChipDisplay, CheckSuperChipRegisters,
+                                                 CheckPublisherTearing, CheckDisassembly, CheckRamSearch};
+
+    bool passed = true;
+    for (const auto& check : checks) passed &= check();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+// Ahead-of-time recompiler driver (see recompiler.h and compiled_rom.h).
+//
+//   Recompile ROM OUTPUT.so               Generate C++ for a ROM and compile it into a shared object
+//   Recompile --dir ROMDIR OUTDIR         The same for every ROM in ROMDIR, as OUTDIR/<name>.so
+//   Recompile --source ROM OUTPUT.cpp     Only generate the C++
+//
+// With --profile DIR, a ROM that has a profile there (rom_profile.h, written
+// by RomBench --profile) is compiled with it: the blocks it ran are covered,
+// including those the static analysis cannot find, and the hottest come first.
+//
+// The code follows the QuirkProfile that LoadROM() detects for the ROM, or
+// with --quirks PROFILE that one (see chip8.h); CompiledRom only runs it on
+// machines set to the same.
+//
+// The compiler is $CXX, or the one the tools were built with. With
+// --keep-source the generated .cpp is left next to the shared object.
+
+#include "headless.h"
+#include "recompiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+
+// Double-quoted for the shell; ROM names have spaces and brackets in them
+static std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\' || c == '$' || c == '`') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+
+static std::string profileDirectory;
+static QuirkProfile quirks = QuirkProfile::Modern;
+static bool pinQuirks = false;
+
+
+static bool Generate(const std::filesystem::path& romPath, const std::filesystem::path& sourcePath) {
+    std::vector<uint8_t> rom = ReadFile(romPath);
+    if (rom.empty() || rom.size() > MAX_ROM_SIZE) {
+        std::cerr << "Cannot read ROM " << romPath << std::endl;
+        return false;
+    }
+
+    RomProfile profile;
+    uint64_t romHash = Fnv1a(rom.data(), rom.size());
+    bool profiled = !profileDirectory.empty() && profile.Load(ProfilePath(profileDirectory, romHash)) &&
+                    profile.romHash == romHash;
+
+    QuirkProfile romQuirks = pinQuirks ? quirks : DetectQuirks(rom.data(), rom.size());
+    std::ofstream source(sourcePath);
+    size_t blocks = GenerateCpp(rom.data(), rom.size(), source, profiled ? &profile : nullptr, romQuirks);
+    source.close();
+    if (!source) {
+        std::cerr << "Cannot write " << sourcePath << std::endl;
+        return false;
+    }
+    std::cout << romPath.filename().string() << ": " << blocks << " blocks, " << QuirkProfileName(romQuirks)
+              << (profiled ? " (profiled)" : "") << std::endl;
+    return true;
+}
+
+
+static bool Compile(const std::filesystem::path& romPath, const std::filesystem::path& outputPath, bool keepSource) {
+    std::filesystem::path sourcePath = outputPath;
+    sourcePath.replace_extension(".cpp");
+    if (!Generate(romPath, sourcePath)) return false;
+
+    const char* compiler = std::getenv("CXX");
+    std::string command = Quote(compiler && *compiler ? compiler : CHIP8_CXX) +
+                          " -std=c++17 -O2 -shared -fPIC -fvisibility=hidden -I" + Quote(CHIP8_SOURCE_DIR) + " " +
+                          Quote(sourcePath.string()) + " -o " + Quote(outputPath.string());
+    bool compiled = std::system(command.c_str()) == 0;
+    if (!compiled) std::cerr << "Compiling " << sourcePath << " failed" << std::endl;
+
+    if (compiled && !keepSource) std::filesystem::remove(sourcePath);
+    return compiled;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool keepSource = false, sourceOnly = false, directory = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--profile" && i + 1 < argc) profileDirectory = argv[++i];
+        else if (arg == "--quirks" && i + 1 < argc && ParseQuirkProfile(argv[i + 1], quirks)) {
+            pinQuirks = true;
+            ++i;
+        }
+        else if (arg == "--keep-source") keepSource = true;
+        else if (arg == "--source") sourceOnly = true;
+        else if (arg == "--dir") directory = true;
+        else args.push_back(arg);
+    }
+    if (args.size() != 2 || (sourceOnly && directory)) {
+        std::cerr << "Usage: " << argv[0] << " [--profile DIR] [--quirks PROFILE] [--keep-source] ROM OUTPUT.so\n"
+                  << "       " << argv[0] << " [--profile DIR] [--quirks PROFILE] [--keep-source] --dir ROMDIR OUTDIR\n"
+                  << "       " << argv[0] << " [--profile DIR] [--quirks PROFILE] --source ROM OUTPUT.cpp" << std::endl;
+        return 2;
+    }
+
+    if (sourceOnly) return Generate(args[0], args[1]) ? 0 : 1;
+    if (!directory) return Compile(args[0], args[1], keepSource) ? 0 : 1;
+
+    std::vector<std::filesystem::path> roms;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(args[0], error)) {
+        if (entry.is_regular_file() && entry.path().filename().string()[0] != '.') roms.push_back(entry.path());
+    }
+    if (error || roms.empty()) {
+        std::cerr << "No ROMs found in " << args[0] << std::endl;
+        return 2;
+    }
+    std::sort(roms.begin(), roms.end());
+    std::filesystem::create_directories(args[1]);
+
+    int failures = 0;
+    for (const auto& rom : roms) {
+        std::filesystem::path output = std::filesystem::path(args[1]) / (rom.filename().string() + ".so");
+        if (!Compile(rom, output, keepSource)) ++failures;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// ROM archive packer (see rom_archive.h for the format).
+//
+//   RomPack OUTPUT.c8pk INPUT...      Pack ROM files and/or directories of ROMs
+//   RomPack --list ARCHIVE.c8pk       List the contents of an archive
+//
+// Directories are not searched recursively and hidden files (such as the
+// catalog index) are skipped. ROMs are stored under their file name.
+
+#include "rom_archive.h"
+#include "chip8.h"
+
+#include <filesystem>
+#include <fstream>
+
+
+static bool AddFile(const std::filesystem::path& path, std::vector<RomToPack>& roms) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Cannot read " << path << std::endl;
+        return false;
+    }
+
+    RomToPack rom;
+    rom.name = path.filename().string();
+    rom.bytes.resize(static_cast<size_t>(file.tellg()));
+    if (rom.bytes.size() > MAX_ROM_SIZE) {
+        std::cerr << "Skipping " << path << ": " << rom.bytes.size() << " bytes is larger than a ROM can be" << std::endl;
+        return true;
+    }
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(rom.bytes.data()), static_cast<std::streamsize>(rom.bytes.size()));
+
+    roms.push_back(std::move(rom));
+    return true;
+}
+
+
+static int List(const std::string& path) {
+    RomArchive archive;
+    if (!archive.Open(path)) {
+        std::cerr << "Not a valid ROM archive: " << path << std::endl;
+        return 1;
+    }
+
+    char line[64];
+    for (size_t i = 0; i < archive.Count(); ++i) {
+        ArchivedRom rom = archive.At(i);
+        snprintf(line, sizeof(line), "%016llx %6zu  ", static_cast<unsigned long long>(rom.hash), rom.size);
+        std::cout << line << rom.name << '\n';
+    }
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && std::string(argv[1]) == "--list") return List(argv[2]);
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " OUTPUT.c8pk INPUT...\n"
+                  << "       " << argv[0] << " --list ARCHIVE.c8pk" << std::endl;
+        return 2;
+    }
+
+    std::vector<RomToPack> roms;
+    for (int i = 2; i < argc; ++i) {
+        std::filesystem::path input = argv[i];
+        if (std::filesystem::is_directory(input)) {
+            std::vector<std::filesystem::path> files;
+            for (const auto& entry : std::filesystem::directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().filename().string()[0] != '.') files.push_back(entry.path());
+            }
+            for (const auto& file : files) {
+                if (!AddFile(file, roms)) return 1;
+            }
+        } else if (!AddFile(input, roms)) {
+            return 1;
+        }
+    }
+
+    if (!RomArchive::Write(argv[1], roms)) {
+        std::cerr << "Cannot write " << argv[1] << " (duplicate ROM names?)" << std::endl;
+        return 1;
+    }
+    std::cout << "Packed " << roms.size() << " ROMs into " << argv[1] << std::endl;
+    return 0;
+}
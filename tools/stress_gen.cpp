@@ -0,0 +1,473 @@
+// Synthetic stress-ROM generator.
+//
+// Emits CHIP-8 programs that each hammer one part of the core, together with
+// the machine state they must end in:
+//
+//   alu      - tight loop over 7xkk and the 8xy_ ALU ops, carries and borrows included
+//   calls    - 2nnn/00EE chain nested STACK_LEVELS deep, entered over and over
+//   sprites  - full-screen Dxyn storm; every second pass collides on every draw
+//   memory   - Fx55/Fx65 with 14 registers sweeping 2 KB of RAM, stepping I with Fx1E
+//   smc      - self-modifying code: Fx55 rewrites the immediate of the next instruction
+//
+// Every program ends in a "JP self" halt. The expected state is computed here
+// with plain C++ arithmetic that mirrors each program loop, not by running the
+// emulator, so --verify genuinely checks the core against an independent model.
+//
+//   StressGen [--out DIR] [--iterations N] [--verify]
+//
+// ROMs are written to DIR (default "stress"), expected states to DIR/expected/
+// as JSON, so DIR can be handed straight to RomBench --roms.
+
+#include "headless.h"
+
+#include <filesystem>
+#include <functional>
+
+
+struct ExpectedState {
+    uint16_t haltPC{};
+    uint8_t V[REGISTER_COUNT]{};
+    uint16_t I{};
+    uint16_t sp{};
+    uint64_t displayHash{};
+    uint16_t memoryStart{}, memoryEnd{};    // Range covered by memoryHash; empty when equal
+    uint64_t memoryHash{};
+};
+
+struct StressROM {
+    std::string name;
+    std::vector<uint8_t> bytes;
+    ExpectedState expected;
+};
+
+
+// Just enough of an assembler to lay out loops: emit big-endian opcodes,
+// take labels with Here() and patch forward references afterwards.
+class Assembler {
+public:
+    [[nodiscard]] uint16_t Here() const { return START_INSTRUCTION_ADDRESS + bytes.size(); }
+
+    void Emit(uint16_t op) {
+        bytes.push_back(op >> 8);
+        bytes.push_back(op & 0xFF);
+    }
+
+    void Patch(uint16_t address, uint16_t op) {
+        bytes[address - START_INSTRUCTION_ADDRESS] = op >> 8;
+        bytes[address - START_INSTRUCTION_ADDRESS + 1] = op & 0xFF;
+    }
+
+    // "JP self": the conventional CHIP-8 halt
+    uint16_t Halt() {
+        uint16_t at = Here();
+        Emit(0x1000 | at);
+        return at;
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+
+// Register-level model of the ALU ops, matching opcodes.cpp
+struct Registers {
+    uint8_t V[REGISTER_COUNT]{};
+
+    void Add(int x, uint8_t kk) { V[x] += kk; }                        // 7xkk
+    void Or(int x, int y) { V[x] |= V[y]; }                             // 8xy1
+    void And(int x, int y) { V[x] &= V[y]; }                            // 8xy2
+    void Xor(int x, int y) { V[x] ^= V[y]; }                            // 8xy3
+    void AddCarry(int x, int y) {                                       // 8xy4
+        unsigned int sum = V[x] + V[y];
+        V[0xF] = sum > 0xFF;
+        V[x] = sum & 0xFF;
+    }
+    void Sub(int x, int y) {                                            // 8xy5
+        uint8_t vx = V[x], vy = V[y];
+        V[0xF] = vx > vy;
+        V[x] = vx - vy;
+    }
+    void Shr(int x) {                                                   // 8xy6
+        V[0xF] = V[x] & 0x1;
+        V[x] >>= 1;
+    }
+    void SubN(int x, int y) {                                           // 8xy7
+        uint8_t vx = V[x], vy = V[y];
+        V[0xF] = vy > vx;
+        V[x] = vy - vx;
+    }
+    void Shl(int x) {                                                   // 8xyE
+        V[0xF] = (V[x] & 0x80) >> 7;
+        V[x] <<= 1;
+    }
+};
+
+static const uint8_t blankDisplay[LORES_WIDTH * LORES_HEIGHT]{};
+
+
+static StressROM MakeALU(uint8_t iterations) {
+    Assembler a;
+    a.Emit(0x6E00 | iterations);                // VE = outer count
+
+    uint16_t inner = a.Here();
+    for (uint16_t op : {0x7103, 0x8214, 0x8324, 0x8435, 0x8506, 0x8511,
+                        0x8613, 0x8711, 0x870E, 0x8877, 0x8910, 0x8962}) {
+        a.Emit(op);
+    }
+    a.Emit(0x7001);                             // V0 += 1
+    a.Emit(0x3000);                             // 256 inner iterations
+    a.Emit(0x1000 | inner);
+    a.Emit(0x7EFF);                             // VE -= 1
+    a.Emit(0x3E00);
+    a.Emit(0x1000 | inner);
+    uint16_t halt = a.Halt();
+
+    Registers r;
+    r.V[0xE] = iterations;
+    do {
+        do {
+            r.Add(1, 0x03);
+            r.AddCarry(2, 1);
+            r.AddCarry(3, 2);
+            r.Sub(4, 3);
+            r.Shr(5);
+            r.Or(5, 1);
+            r.Xor(6, 1);
+            r.Or(7, 1);
+            r.Shl(7);
+            r.SubN(8, 7);
+            r.V[9] = r.V[1];
+            r.And(9, 6);
+            r.Add(0, 1);
+        } while (r.V[0] != 0);
+        r.Add(0xE, 0xFF);
+    } while (r.V[0xE] != 0);
+
+    StressROM rom{"alu", a.bytes};
+    rom.expected.haltPC = halt;
+    memcpy(rom.expected.V, r.V, sizeof(r.V));
+    rom.expected.displayHash = Fnv1a(blankDisplay, sizeof(blankDisplay));
+    return rom;
+}
+
+
+static StressROM MakeCalls(uint8_t iterations) {
+    Assembler a;
+    a.Emit(0x6E00 | iterations);
+
+    // 255 inner iterations rather than 256, so that the sums below do not
+    // wrap back to zero and the final registers actually say something.
+    uint16_t outer = a.Here();
+    a.Emit(0x6001);
+    uint16_t loop = a.Here();
+    uint16_t firstCall = a.Here();
+    a.Emit(0x2000);                             // Patched below
+    a.Emit(0x7001);
+    a.Emit(0x3000);
+    a.Emit(0x1000 | loop);
+    a.Emit(0x7EFF);
+    a.Emit(0x3E00);
+    a.Emit(0x1000 | outer);
+    uint16_t halt = a.Halt();
+
+    // sub_k: V1 += 1; V2 += V1; CALL sub_k+1; RET. The main loop is not itself a
+    // subroutine, so STACK_LEVELS nested calls exactly fill the stack.
+    uint16_t pendingCall = firstCall;
+    for (unsigned int depth = 1; depth <= STACK_LEVELS; ++depth) {
+        a.Patch(pendingCall, 0x2000 | a.Here());
+        a.Emit(0x7101);
+        a.Emit(0x8214);
+        if (depth < STACK_LEVELS) {
+            pendingCall = a.Here();
+            a.Emit(0x2000);
+        }
+        a.Emit(0x00EE);
+    }
+
+    Registers r;
+    r.V[0xE] = iterations;
+    do {
+        r.V[0] = 1;
+        do {
+            for (unsigned int depth = 1; depth <= STACK_LEVELS; ++depth) {
+                r.Add(1, 1);
+                r.AddCarry(2, 1);
+            }
+            r.Add(0, 1);
+        } while (r.V[0] != 0);
+        r.Add(0xE, 0xFF);
+    } while (r.V[0xE] != 0);
+
+    StressROM rom{"calls", a.bytes};
+    rom.expected.haltPC = halt;
+    memcpy(rom.expected.V, r.V, sizeof(r.V));
+    rom.expected.displayHash = Fnv1a(blankDisplay, sizeof(blankDisplay));
+    return rom;
+}
+
+
+static StressROM MakeSprites(uint8_t iterations) {
+    const unsigned int spriteHeight = 8;
+
+    Assembler a;
+    uint16_t loadSprite = a.Here();
+    a.Emit(0xA000);                             // Patched to the sprite data below
+    a.Emit(0x6E00 | iterations);
+
+    uint16_t outer = a.Here();
+    a.Emit(0x6200);                             // V2 = pass
+    uint16_t pass = a.Here();
+    a.Emit(0x6100);                             // V1 = y
+    uint16_t row = a.Here();
+    a.Emit(0x6000);                             // V0 = x
+    uint16_t column = a.Here();
+    a.Emit(0xD010 | spriteHeight);
+    a.Emit(0x85F4);                             // V5 += VF (collision count)
+    a.Emit(0x7000 | 8);
+    a.Emit(0x3000 | LORES_WIDTH);
+    a.Emit(0x1000 | column);
+    a.Emit(0x7100 | spriteHeight);
+    a.Emit(0x3100 | LORES_HEIGHT);
+    a.Emit(0x1000 | row);
+    a.Emit(0x7201);
+    a.Emit(0x3202);                             // Two passes: fill, then clear
+    a.Emit(0x1000 | pass);
+    a.Emit(0x7EFF);
+    a.Emit(0x3E00);
+    a.Emit(0x1000 | outer);
+    uint16_t halt = a.Halt();
+
+    uint16_t sprite = a.Here();
+    a.Patch(loadSprite, 0xA000 | sprite);
+    for (unsigned int i = 0; i < spriteHeight; ++i) a.bytes.push_back(0xFF);
+
+    // The first pass tiles the blank screen without a single collision; the
+    // second pass lands on the same tiles, collides on every draw and leaves
+    // the screen blank again.
+    const unsigned int draws = (LORES_WIDTH / 8) * (LORES_HEIGHT / spriteHeight);
+    Registers r;
+    r.V[0xE] = iterations;
+    do {
+        for (int collision = 0; collision <= 1; ++collision) {
+            for (unsigned int i = 0; i < draws; ++i) {
+                r.V[0xF] = collision;
+                r.AddCarry(5, 0xF);
+            }
+        }
+        r.Add(0xE, 0xFF);
+    } while (r.V[0xE] != 0);
+    r.V[0] = LORES_WIDTH;
+    r.V[1] = LORES_HEIGHT;
+    r.V[2] = 2;
+
+    StressROM rom{"sprites", a.bytes};
+    rom.expected.haltPC = halt;
+    memcpy(rom.expected.V, r.V, sizeof(r.V));
+    rom.expected.I = sprite;
+    rom.expected.displayHash = Fnv1a(blankDisplay, sizeof(blankDisplay));
+    return rom;
+}
+
+
+static StressROM MakeMemory(uint8_t iterations) {
+    const uint16_t base = 0x400;
+    const uint8_t stride = 14;                  // V0..VD are stored, VC holds the stride
+    const uint8_t slots = 160;                  // 160 * 14 bytes ends at 0xCC0
+
+    Assembler a;
+    for (int x = 0; x < 0xC; ++x) a.Emit(0x6000 | (x << 8) | ((x * 17 + 1) & 0xFF));
+    a.Emit(0x6C00 | stride);
+    a.Emit(0x6E00 | iterations);
+
+    uint16_t outer = a.Here();
+    a.Emit(0xA000 | base);
+    uint16_t inner = a.Here();
+    a.Emit(0xFD55);                             // Store V0..VD at I
+    a.Emit(0xFF1E);                             // I += VF, which stays 0: a load right after a store
+                                                // would otherwise make DetectQuirks() pick vip
+    a.Emit(0xFD65);                             // ...and read them straight back
+    a.Emit(0x7001);
+    a.Emit(0xFC1E);                             // I += stride
+    a.Emit(0x7D01);
+    a.Emit(0x3D00 | slots);
+    a.Emit(0x1000 | inner);
+    a.Emit(0x6D00);
+    a.Emit(0x7EFF);
+    a.Emit(0x3E00);
+    a.Emit(0x1000 | outer);
+    uint16_t halt = a.Halt();
+
+    Registers r;
+    uint8_t ram[RAM_SIZE]{};
+    uint16_t I = 0;
+    for (int x = 0; x < 0xC; ++x) r.V[x] = (x * 17 + 1) & 0xFF;
+    r.V[0xC] = stride;
+    r.V[0xE] = iterations;
+    do {
+        I = base;
+        do {
+            memcpy(&ram[I], r.V, 0xD + 1);
+            r.Add(0, 1);
+            I += r.V[0xC];
+            r.Add(0xD, 1);
+        } while (r.V[0xD] != slots);
+        r.V[0xD] = 0;
+        r.Add(0xE, 0xFF);
+    } while (r.V[0xE] != 0);
+
+    StressROM rom{"memory", a.bytes};
+    rom.expected.haltPC = halt;
+    memcpy(rom.expected.V, r.V, sizeof(r.V));
+    rom.expected.I = I;
+    rom.expected.displayHash = Fnv1a(blankDisplay, sizeof(blankDisplay));
+    rom.expected.memoryStart = base;
+    rom.expected.memoryEnd = base + stride * slots;
+    rom.expected.memoryHash = Fnv1a(&ram[base], stride * slots);
+    return rom;
+}
+
+
+static StressROM MakeSelfModifying(uint8_t iterations) {
+    Assembler a;
+    a.Emit(0x6072);                             // V0 = 0x72, the high byte of "ADD V2, kk"
+    a.Emit(0x6E00 | iterations);
+
+    uint16_t loop = a.Here();
+    a.Emit(0x7101);                             // V1 += 1
+    uint16_t pointAtTarget = a.Here();
+    a.Emit(0xA000);                             // Patched below
+    a.Emit(0xF155);                             // Overwrite the next instruction with 72 V1
+    uint16_t target = a.Here();
+    a.Emit(0x7200);                             // ADD V2, <rewritten>
+    a.Emit(0x3100);
+    a.Emit(0x1000 | loop);
+    a.Emit(0x7EFF);
+    a.Emit(0x3E00);
+    a.Emit(0x1000 | loop);
+    uint16_t halt = a.Halt();
+    a.Patch(pointAtTarget, 0xA000 | target);
+
+    Registers r;
+    r.V[0] = 0x72;
+    r.V[0xE] = iterations;
+    do {
+        do {
+            r.Add(1, 1);
+            r.Add(2, r.V[1]);
+        } while (r.V[1] != 0);
+        r.Add(0xE, 0xFF);
+    } while (r.V[0xE] != 0);
+
+    const uint8_t rewritten[2] = {0x72, r.V[1]};
+
+    StressROM rom{"smc", a.bytes};
+    rom.expected.haltPC = halt;
+    memcpy(rom.expected.V, r.V, sizeof(r.V));
+    rom.expected.I = target;
+    rom.expected.displayHash = Fnv1a(blankDisplay, sizeof(blankDisplay));
+    rom.expected.memoryStart = target;
+    rom.expected.memoryEnd = target + 2;
+    rom.expected.memoryHash = Fnv1a(rewritten, sizeof(rewritten));
+    return rom;
+}
+
+
+static void WriteExpected(std::ostream& out, const StressROM& rom) {
+    const ExpectedState& e = rom.expected;
+    char text[128];
+
+    snprintf(text, sizeof(text), "{\"rom\":\"%s\",\"halt_pc\":\"0x%03X\",\"V\":[", rom.name.c_str(), e.haltPC);
+    out << text;
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        snprintf(text, sizeof(text), "\"%02X\"%s", e.V[i], i + 1 < REGISTER_COUNT ? "," : "");
+        out << text;
+    }
+    snprintf(text, sizeof(text), "],\"I\":\"0x%03X\",\"sp\":%u,\"display_hash\":\"%016llx\",",
+             e.I, e.sp, static_cast<unsigned long long>(e.displayHash));
+    out << text;
+    snprintf(text, sizeof(text), "\"memory\":{\"start\":\"0x%03X\",\"end\":\"0x%03X\",\"hash\":\"%016llx\"}}\n",
+             e.memoryStart, e.memoryEnd, static_cast<unsigned long long>(e.memoryHash));
+    out << text;
+}
+
+
+// Run the ROM until it reaches its halt loop and compare against the model.
+static bool Verify(const std::filesystem::path& path, const StressROM& rom) {
+    const uint64_t budget = 100000000;
+    const ExpectedState& e = rom.expected;
+
+    Chip8 chip8;
+    chip8.Seed(1);
+    chip8.LoadROM(path.string());
+
+    uint64_t executed = 0;
+    while (executed < budget && !(chip8.PC() == e.haltPC && executed > 0)) {
+        if (chip8.Cycle() != Fault::None) break;
+        ++executed;
+    }
+
+    std::vector<std::string> mismatches;
+    if (chip8.LastFault() != Fault::None) mismatches.emplace_back(FaultName(chip8.LastFault()));
+    if (chip8.PC() != e.haltPC) mismatches.emplace_back("did not reach halt");
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        if (chip8.Registers()[i] != e.V[i]) mismatches.push_back("V" + std::to_string(i));
+    }
+    if (chip8.Index() != e.I) mismatches.emplace_back("I");
+    if (chip8.SP() != e.sp) mismatches.emplace_back("sp");
+    if (FramebufferHash(chip8) != e.displayHash) mismatches.emplace_back("display");
+    if (e.memoryEnd > e.memoryStart) {
+        std::vector<uint8_t> memory(e.memoryEnd - e.memoryStart);
+        chip8.ReadMemory(e.memoryStart, memory.data(), memory.size());
+        if (Fnv1a(memory.data(), memory.size()) != e.memoryHash) mismatches.emplace_back("memory");
+    }
+
+    std::cout << (mismatches.empty() ? "  PASS  " : "  FAIL  ") << rom.name << " (" << executed << " instructions)";
+    for (const std::string& m : mismatches) std::cout << ' ' << m;
+    std::cout << std::endl;
+    return mismatches.empty();
+}
+
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path outDirectory = "stress";
+    int iterations = 255;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) outDirectory = argv[++i];
+        else if (arg == "--iterations" && i + 1 < argc) iterations = std::stoi(argv[++i]);
+        else if (arg == "--verify") verify = true;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--out DIR] [--iterations 1-255] [--verify]" << std::endl;
+            return 2;
+        }
+    }
+    if (iterations < 1 || iterations > 255) {
+        std::cerr << "--iterations must be between 1 and 255" << std::endl;
+        return 2;
+    }
+
+    std::vector<std::function<StressROM(uint8_t)>> generators = {
+            MakeALU, MakeCalls, MakeSprites, MakeMemory, MakeSelfModifying};
+
+    std::filesystem::create_directories(outDirectory / "expected");
+
+    bool passed = true;
+    for (const auto& generate : generators) {
+        StressROM rom = generate(static_cast<uint8_t>(iterations));
+
+        std::filesystem::path romPath = outDirectory / (rom.name + ".ch8");
+        {
+            std::ofstream file(romPath, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(rom.bytes.data()), static_cast<std::streamsize>(rom.bytes.size()));
+        }
+        {
+            std::ofstream file(outDirectory / "expected" / (rom.name + ".json"));
+            WriteExpected(file, rom);
+        }
+
+        if (verify) passed &= Verify(romPath, rom);
+    }
+
+    return passed ? 0 : 1;
+}
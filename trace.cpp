@@ -0,0 +1,124 @@
+#include "trace.h"
+
+#include <bit>
+#include <cstdio>
+
+// The ring is indexed with a mask, so the depth is rounded up to a power of
+// two (at least 1)
+InstructionTrace::InstructionTrace(size_t depth)
+        : entries(std::bit_ceil(depth == 0 ? size_t{1} : depth)), mask(entries.size() - 1) {}
+
+
+const char* OpcodeName(uint16_t opcode) {
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0) return "00E0";
+            if (opcode == 0x00EE) return "00EE";
+            if ((opcode & 0xFFF0) == 0x00C0) return "00Cn";
+            if (opcode == 0x00FB) return "00FB";
+            if (opcode == 0x00FC) return "00FC";
+            if (opcode == 0x00FD) return "00FD";
+            if (opcode == 0x00FE) return "00FE";
+            if (opcode == 0x00FF) return "00FF";
+            return "0nnn";
+        case 0x1000: return "1nnn";
+        case 0x2000: return "2nnn";
+        case 0x3000: return "3xkk";
+        case 0x4000: return "4xkk";
+        case 0x5000: return "5xy0";
+        case 0x6000: return "6xkk";
+        case 0x7000: return "7xkk";
+        case 0x8000:
+            switch (opcode & 0x000F) {
+                case 0x0: return "8xy0";
+                case 0x1: return "8xy1";
+                case 0x2: return "8xy2";
+                case 0x3: return "8xy3";
+                case 0x4: return "8xy4";
+                case 0x5: return "8xy5";
+                case 0x6: return "8xy6";
+                case 0x7: return "8xy7";
+                case 0xE: return "8xyE";
+                default:  return "8xy?";
+            }
+        case 0x9000: return "9xy0";
+        case 0xA000: return "Annn";
+        case 0xB000: return "Bnnn";
+        case 0xC000: return "Cxkk";
+        case 0xD000: return "Dxyn";
+        case 0xE000:
+            if ((opcode & 0x00FF) == 0x9E) return "Ex9E";
+            if ((opcode & 0x00FF) == 0xA1) return "ExA1";
+            return "Ex??";
+        default:
+            switch (opcode & 0x00FF) {
+                case 0x07: return "Fx07";
+                case 0x0A: return "Fx0A";
+                case 0x15: return "Fx15";
+                case 0x18: return "Fx18";
+                case 0x1E: return "Fx1E";
+                case 0x29: return "Fx29";
+                case 0x30: return "Fx30";
+                case 0x33: return "Fx33";
+                case 0x55: return "Fx55";
+                case 0x65: return "Fx65";
+                case 0x75: return "Fx75";
+                case 0x85: return "Fx85";
+                default:   return "Fx??";
+            }
+    }
+}
+
+
+void InstructionTrace::DumpText(std::ostream& out, const uint8_t* liveV) const {
+    char line[160];
+    size_t n = Size();
+    uint64_t firstCycle = count - n;
+
+    out << "cycle        pc     opcode  I       op    changes\n";
+    for (size_t i = 0; i < n; ++i) {
+        const TraceEntry& entry = At(i);
+        const uint8_t* after = (i + 1 < n) ? At(i + 1).V : liveV;
+
+        int len = snprintf(line, sizeof(line), "%-12llu 0x%03X  %04X    0x%03X   %s ",
+                           static_cast<unsigned long long>(firstCycle + i),
+                           entry.pc, entry.opcode, entry.I, OpcodeName(entry.opcode));
+
+        for (int r = 0; r < 16 && len < static_cast<int>(sizeof(line)) - 16; ++r) {
+            if (entry.V[r] != after[r]) {
+                len += snprintf(line + len, sizeof(line) - len, " V%X:%02X->%02X", r, entry.V[r], after[r]);
+            }
+        }
+        out << line << '\n';
+    }
+}
+
+
+// Chrome's trace viewer (chrome://tracing, ui.perfetto.dev) wants microseconds
+// in "ts"; one emulated instruction is reported as one microsecond so that the
+// timeline reads as instruction count.
+void InstructionTrace::DumpChromeJSON(std::ostream& out, const uint8_t* liveV) const {
+    char event[320];
+    size_t n = Size();
+    uint64_t firstCycle = count - n;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < n; ++i) {
+        const TraceEntry& entry = At(i);
+        const uint8_t* after = (i + 1 < n) ? At(i + 1).V : liveV;
+
+        int len = snprintf(event, sizeof(event),
+                           "{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,"
+                           "\"ts\":%llu,\"dur\":1,\"args\":{\"pc\":\"0x%03X\",\"opcode\":\"%04X\",\"I\":\"0x%03X\"",
+                           OpcodeName(entry.opcode), static_cast<unsigned long long>(firstCycle + i),
+                           entry.pc, entry.opcode, entry.I);
+
+        for (int r = 0; r < 16 && len < static_cast<int>(sizeof(event)) - 24; ++r) {
+            if (entry.V[r] != after[r]) {
+                len += snprintf(event + len, sizeof(event) - len, ",\"V%X\":\"%02X->%02X\"", r, entry.V[r], after[r]);
+            }
+        }
+        out << event << "}}" << (i + 1 < n ? ",\n" : "\n");
+    }
+    out << "]}\n";
+}
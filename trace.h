@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+const unsigned int TRACE_DEPTH = 256;   // Number of instructions kept by the trace (must be a power of two)
+
+
+// A single executed instruction. The register file is captured *before* the
+// instruction runs, so the effect of entry k is the difference between the
+// snapshot of entry k and the snapshot of entry k + 1 (or the live registers
+// for the newest entry). This keeps recording down to a handful of stores.
+struct TraceEntry {
+    uint16_t pc;        // Address the opcode was fetched from
+    uint16_t opcode;    // Raw opcode
+    uint16_t I;         // Index register before execution
+    uint8_t V[16];      // V0..VF before execution
+};
+
+
+// Fixed-size ring buffer of the last TRACE_DEPTH executed instructions.
+// Chip8::Cycle() writes one entry per instruction; nothing is allocated after
+// construction and old entries are simply overwritten.
+class InstructionTrace {
+public:
+    explicit InstructionTrace(size_t depth = TRACE_DEPTH);     // Rounded up to a power of two
+
+    // A trace is the history of the machine that recorded it, so a copy of a
+    // machine starts with an empty one. Assigning keeps this trace's own
+    // buffer (and depth), which makes copying a machine into an existing one
+    // allocation-free.
+    InstructionTrace(const InstructionTrace& other) : InstructionTrace(other.entries.size()) {}
+    InstructionTrace& operator=(const InstructionTrace&) {
+        count = 0;
+        return *this;
+    }
+
+    // Record the instruction about to be executed.
+    void Record(uint16_t pc, uint16_t opcode, uint16_t I, const uint8_t* V) {
+        TraceEntry& entry = entries[count++ & mask];
+        entry.pc = pc;
+        entry.opcode = opcode;
+        entry.I = I;
+        memcpy(entry.V, V, sizeof(entry.V));
+    }
+
+    void Clear() { count = 0; }
+
+    [[nodiscard]] uint64_t Count() const { return count; }   // Instructions recorded since the last Clear()
+    [[nodiscard]] size_t Size() const { return count < entries.size() ? count : entries.size(); }
+
+    // Entry i of the retained window, 0 being the oldest.
+    [[nodiscard]] const TraceEntry& At(size_t i) const { return entries[(count - Size() + i) & mask]; }
+
+    // liveV is the current register file; it is needed to compute the effect of the newest entry.
+    void DumpText(std::ostream& out, const uint8_t* liveV) const;
+    void DumpChromeJSON(std::ostream& out, const uint8_t* liveV) const;
+
+private:
+    std::vector<TraceEntry> entries;
+    uint64_t mask;
+    uint64_t count{};
+};
+
+// Returns the opcode pattern (e.g. "8xy4", "Dxyn") used to name the handlers in opcodes.cpp.
+const char* OpcodeName(uint16_t opcode);
@@ -0,0 +1,235 @@
+#include "vector_env.h"
+
+#include <bit>
+#include <cstring>
+
+VectorEnv::~VectorEnv() {
+    StopWorkers();
+}
+
+
+bool VectorEnv::Open(EnvConfig envConfig, size_t count) {
+    // Reopening replaces everything, the workers included: the old ones
+    // would still be splitting the old instance count
+    StopWorkers();
+    config = std::move(envConfig);
+
+    // Every instance is a copy of one loaded machine, so they all share the
+    // ROM's memory pages until they write to them. A short trace is plenty
+    // for a machine nobody is debugging.
+    Chip8 prototype(16);
+    if (count == 0 || !prototype.LoadROM(config.rom.data(), config.rom.size())) return false;
+
+    // The observation has the largest resolution the ROM can switch to
+    bool superChip = QuirksOf(prototype.GetQuirks()).superChipOpcodes;
+    observationWidth = superChip ? HIRES_WIDTH : LORES_WIDTH;
+    observationHeight = superChip ? HIRES_HEIGHT : LORES_HEIGHT;
+
+    machines.assign(count, prototype);
+    rewardValues.assign(count * config.rewards.size(), 0);
+    seeds.assign(count, 0);
+    steps.assign(count, 0);
+    finished.assign(count, 0);
+
+    unsigned int threads = config.threads == 0 ? 1 : config.threads;
+    if (threads > count) threads = static_cast<unsigned int>(count);
+    for (unsigned int t = 1; t < threads; ++t) workers.emplace_back(&VectorEnv::WorkerLoop, this, t, threads);
+    return true;
+}
+
+
+size_t VectorEnv::ObservationSize() const {
+    size_t pixels = observationWidth * observationHeight;
+    return config.observation == ObservationFormat::Bits ? pixels / 8 : pixels;
+}
+
+
+void VectorEnv::Reset(const uint32_t* initialSeeds, uint8_t* observations) {
+    RunParallel([&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ResetOne(i, initialSeeds ? initialSeeds[i] : static_cast<uint32_t>(i));
+            WriteObservation(i, observations + i * ObservationSize());
+        }
+    });
+}
+
+
+void VectorEnv::Step(const uint16_t* actions, uint8_t* observations, float* rewards, uint8_t* done) {
+    RunParallel([&](size_t begin, size_t end) { StepRange(begin, end, actions, observations, rewards, done); });
+}
+
+
+// Reset() only restores the memory pages the last episode wrote, so starting
+// an episode costs about as much as a step.
+void VectorEnv::ResetOne(size_t i, uint32_t seed) {
+    Chip8& machine = machines[i];
+    machine.Reset();
+    machine.Seed(seed);
+
+    seeds[i] = seed;
+    steps[i] = 0;
+    finished[i] = 0;
+    for (size_t p = 0; p < config.rewards.size(); ++p) {
+        rewardValues[i * config.rewards.size() + p] = machine.Peek(config.rewards[p].address);
+    }
+}
+
+
+void VectorEnv::StepRange(size_t begin, size_t end, const uint16_t* actions, uint8_t* observations,
+                          float* rewards, uint8_t* done) {
+    const size_t probeCount = config.rewards.size();
+
+    for (size_t i = begin; i < end; ++i) {
+        Chip8& machine = machines[i];
+
+        // A new seed per episode, still reproducible from the initial ones
+        if (finished[i]) ResetOne(i, seeds[i] + static_cast<uint32_t>(machines.size()));
+
+        ApplyKeys(machine, actions[i]);
+        for (uint32_t frame = 0; frame < config.frameSkip; ++frame) {
+            if (machine.RunCycles(config.cyclesPerFrame) != Fault::None) break;
+        }
+        ++steps[i];
+
+        float reward = 0;
+        uint8_t* previous = &rewardValues[i * probeCount];
+        for (size_t p = 0; p < probeCount; ++p) {
+            const RewardProbe& probe = config.rewards[p];
+            uint8_t value = machine.Peek(probe.address);
+            reward += probe.scale * static_cast<float>(probe.delta ? value - previous[p] : value);
+            previous[p] = value;
+        }
+
+        bool ended = Finished(machine) || (config.maxSteps != 0 && steps[i] >= config.maxSteps);
+        finished[i] = ended;
+        done[i] = ended;
+        rewards[i] = reward;
+        WriteObservation(i, observations + i * ObservationSize());
+    }
+}
+
+
+// Each bit of a 32-pixel half row twice, for a lores screen in a hires
+// observation: spread the bits apart, then fill every gap with its neighbour.
+static uint64_t DoublePixels(uint64_t half) {
+    half = (half | half << 16) & 0x0000FFFF0000FFFFull;
+    half = (half | half << 8) & 0x00FF00FF00FF00FFull;
+    half = (half | half << 4) & 0x0F0F0F0F0F0F0F0Full;
+    half = (half | half << 2) & 0x3333333333333333ull;
+    half = (half | half << 1) & 0x5555555555555555ull;
+    return half | half << 1;
+}
+
+
+// The display rows are already packed leftmost pixel first, so the bit-packed
+// observation is each row word in big-endian byte order.
+void VectorEnv::WriteObservation(size_t i, uint8_t* out) const {
+    const Chip8& machine = machines[i];
+    const unsigned int scale = observationWidth / machine.DisplayWidth();
+    const unsigned int words = observationWidth / 64;
+
+    for (unsigned int y = 0; y < observationHeight; ++y) {
+        const uint64_t* row = machine.display[y / scale];
+        uint64_t doubled[DISPLAY_ROW_WORDS];
+        if (scale == 2) {
+            doubled[0] = DoublePixels(row[0] >> 32);
+            doubled[1] = DoublePixels(row[0] & 0xFFFFFFFF);
+            row = doubled;
+        }
+
+        for (unsigned int word = 0; word < words; ++word) {
+            if (config.observation == ObservationFormat::Bits) {
+                for (int shift = 56; shift >= 0; shift -= 8) *out++ = static_cast<uint8_t>(row[word] >> shift);
+                continue;
+            }
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                uint8_t byte = static_cast<uint8_t>(row[word] >> shift);
+                if constexpr (std::endian::native == std::endian::little) {
+                    // Copy the byte into every lane, keep bit 7 - k in lane k,
+                    // then carry each kept bit up to the top of its lane
+                    uint64_t lanes = (byte * 0x0101010101010101ull) & 0x0102040810204080ull;
+                    lanes = ((lanes + 0x7F7F7F7F7F7F7F7Full) >> 7) & 0x0101010101010101ull;
+                    memcpy(out, &lanes, sizeof(lanes));
+                    out += sizeof(lanes);
+                } else {
+                    for (int bit = 7; bit >= 0; --bit) *out++ = byte >> bit & 1;
+                }
+            }
+        }
+    }
+}
+
+
+bool VectorEnv::Finished(const Chip8& machine) const {
+    if (machine.LastFault() != Fault::None) return true;
+
+    for (const DoneProbe& probe : config.done) {
+        uint8_t value = machine.Peek(probe.address) & probe.mask;
+        switch (probe.compare) {
+            case DoneProbe::Equal:      if (value == probe.value) return true; break;
+            case DoneProbe::NotEqual:   if (value != probe.value) return true; break;
+            case DoneProbe::Less:       if (value < probe.value) return true; break;
+            case DoneProbe::Greater:    if (value > probe.value) return true; break;
+        }
+    }
+    return false;
+}
+
+
+// The calling thread takes the first slice of the instances, each worker one
+// of the others.
+void VectorEnv::RunParallel(const std::function<void(size_t, size_t)>& work) {
+    if (workers.empty()) {
+        work(0, machines.size());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = work;
+        pending = static_cast<unsigned int>(workers.size());
+        ++generation;
+    }
+    startWork.notify_all();
+
+    size_t slices = workers.size() + 1;
+    work(0, machines.size() / slices);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this] { return pending == 0; });
+}
+
+
+// Join the workers and leave the pool as a new VectorEnv has it.
+void VectorEnv::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startWork.notify_all();
+    for (std::thread& worker : workers) worker.join();
+
+    workers.clear();
+    stopping = false;
+    generation = 0;
+}
+
+
+void VectorEnv::WorkerLoop(unsigned int index, unsigned int slices) {
+    uint64_t seen = 0;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        startWork.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        std::function<void(size_t, size_t)> work = job;
+        lock.unlock();
+
+        size_t count = machines.size();
+        work(count * index / slices, count * (index + 1) / slices);
+
+        lock.lock();
+        if (--pending == 0) workDone.notify_one();
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "chip8.h"
+#include "headless.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Batched reinforcement-learning environment: N copies of one ROM stepped in
+// lockstep, gym style.
+//
+//   VectorEnv env;
+//   env.Open(config, 256);
+//   env.Reset(seeds, observations);
+//   env.Step(actions, observations, rewards, done);     // repeatedly
+//
+// An action is the keypad state for the step (bit k = key k pressed, as in
+// InputScript). Observations are written straight into the caller's buffer,
+// ObservationSize() bytes per instance back to back: either the framebuffer
+// as is (one byte per pixel) or bit-packed, 8 pixels per byte with the
+// leftmost pixel in the high bit, like sprite data.
+//
+// The observation is 64x32, or 128x64 for a ROM whose QuirkProfile has the
+// SUPER-CHIP opcodes (chip8.h); there a lores screen has its pixels doubled,
+// so the size stays the same when the ROM switches resolution.
+//
+// Rewards and episode ends are read from RAM through probes, so that no game
+// code is needed: most games keep their score and lives at a fixed address.
+// An instance whose episode ended is reset (with a new seed) at the start of
+// its next Step(), and the observation returned with done set is the last one
+// of the old episode.
+
+enum class ObservationFormat : uint8_t {
+    Bytes,      // One byte per pixel, 0 or 1
+    Bits        // One bit per pixel
+};
+
+// reward += scale * (value - value before the step), or scale * value
+struct RewardProbe {
+    uint16_t address{};
+    float scale{1};
+    bool delta{true};
+};
+
+// The episode ends when (byte at address & mask) <compare> value
+struct DoneProbe {
+    enum Compare : uint8_t { Equal, NotEqual, Less, Greater };
+
+    uint16_t address{};
+    uint8_t mask{0xFF};
+    Compare compare{Equal};
+    uint8_t value{};
+};
+
+struct EnvConfig {
+    std::vector<uint8_t> rom;
+    uint32_t frameSkip{4};                          // Frames per step, all with the same keys held
+    uint32_t cyclesPerFrame{CYCLES_PER_FRAME};
+    uint32_t maxSteps{};                            // Episode length limit; 0 = none
+    ObservationFormat observation{ObservationFormat::Bits};
+    std::vector<RewardProbe> rewards;
+    std::vector<DoneProbe> done;                    // Any one of them ends the episode (as does a fault)
+    unsigned int threads{1};                        // Worker threads the instances are split across
+};
+
+
+class VectorEnv {
+public:
+    VectorEnv() = default;
+    ~VectorEnv();
+
+    // Load the ROM into `count` instances and start the worker threads. False
+    // if the ROM cannot be loaded; nothing else is valid until this succeeds.
+    // Opening again stops the running workers and starts over.
+    bool Open(EnvConfig envConfig, size_t count);
+
+    VectorEnv(const VectorEnv&) = delete;
+    VectorEnv& operator=(const VectorEnv&) = delete;
+
+    [[nodiscard]] size_t Count() const { return machines.size(); }
+    [[nodiscard]] size_t ObservationSize() const;
+
+    // Start a new episode everywhere. seeds (Count() of them, for opcode_Cxkk)
+    // may be null, in which case instance i uses seed i.
+    void Reset(const uint32_t* seeds, uint8_t* observations);
+
+    // actions, rewards and done hold Count() entries, observations
+    // Count() * ObservationSize() bytes.
+    void Step(const uint16_t* actions, uint8_t* observations, float* rewards, uint8_t* done);
+
+    [[nodiscard]] const Chip8& Machine(size_t i) const { return machines[i]; }
+
+private:
+    EnvConfig config;
+    std::vector<Chip8> machines;                    // Copies of one loaded machine, sharing the ROM's pages
+    unsigned int observationWidth{LORES_WIDTH};
+    unsigned int observationHeight{LORES_HEIGHT};
+
+    std::vector<uint8_t> rewardValues;              // Count() * rewards.size() bytes, value before the step
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> steps;
+    std::vector<uint8_t> finished;                  // The episode ended on the last Step()
+
+    void ResetOne(size_t i, uint32_t seed);
+    void StepRange(size_t begin, size_t end, const uint16_t* actions, uint8_t* observations,
+                   float* rewards, uint8_t* done);
+    void WriteObservation(size_t i, uint8_t* out) const;
+    [[nodiscard]] bool Finished(const Chip8& machine) const;
+
+    // Workers for config.threads > 1; RunParallel() hands each one a slice of
+    // the instances and waits for all of them.
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startWork, workDone;
+    std::function<void(size_t, size_t)> job;
+    uint64_t generation{};
+    unsigned int pending{};
+    bool stopping{};
+
+    void RunParallel(const std::function<void(size_t, size_t)>& work);
+    void StopWorkers();
+    void WorkerLoop(unsigned int index, unsigned int slices);
+};